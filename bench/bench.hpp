@@ -0,0 +1,96 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace dispatcher::bench {
+
+using Clock = std::chrono::steady_clock;
+
+struct Params {
+    std::string suite;  // queue, priority_queue, dispatcher, graph, parallel
+    std::string variant;
+    size_t producers = 1;
+    size_t consumers = 1;
+    size_t task_size = 16;
+    int high_percent = 0;
+    size_t ops = 200000;
+
+    std::string name() const;
+};
+
+struct Result {
+    Params params;
+    double seconds = 0;
+    // enqueue-to-run latencies in nanoseconds, sorted
+    std::vector<uint64_t> latencies;
+};
+
+// Collects enqueue-to-run latencies. Every thread that runs tasks appends to its own buffer,
+// so recording is a push_back with no shared writes.
+class LatencyRecorder {
+public:
+    explicit LatencyRecorder(size_t expected) : expected_(expected), id_(next_id()) {}
+
+    void record(Clock::time_point enqueued) {
+        auto latency = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - enqueued).count();
+        local().push_back(static_cast<uint64_t>(latency));
+    }
+
+    std::vector<uint64_t> collect() {
+        std::vector<uint64_t> all;
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto &buffer : buffers_) {
+            all.insert(all.end(), buffer->begin(), buffer->end());
+        }
+        std::sort(all.begin(), all.end());
+        return all;
+    }
+
+private:
+    std::vector<uint64_t> &local() {
+        // recorders are told apart by id, a new one may reuse the address of an old one
+        thread_local uint64_t owner = 0;
+        thread_local std::vector<uint64_t> *buffer = nullptr;
+        if (owner != id_) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            buffers_.push_back(std::make_unique<std::vector<uint64_t>>());
+            buffers_.back()->reserve(expected_);
+            buffer = buffers_.back().get();
+            owner = id_;
+        }
+        return *buffer;
+    }
+
+    static uint64_t next_id() {
+        static std::atomic<uint64_t> id{0};
+        return ++id;
+    }
+
+    size_t expected_;
+    const uint64_t id_;
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<std::vector<uint64_t>>> buffers_;
+};
+
+// variant: bounded, unbounded, ring_buffer, segmented
+Result run_queue(const Params &params);
+// variant: mutex, lock_free (type of the High lane)
+Result run_priority_queue(const Params &params);
+// variant: shared, work_stealing
+Result run_dispatcher(const Params &params);
+// variant: chain (every node waits for the previous one), fanout (one root, the rest in parallel);
+// one graph is built and run until at least ops nodes have run, latency is counted from the start of the run
+Result run_graph(const Params &params);
+// y[i] += a * x[i] over ops doubles; variant: per_element (a task per index), parallel_for
+Result run_parallel(const Params &params);
+
+void write_json(std::ostream &out, const std::vector<Result> &results);
+
+}  // namespace dispatcher::bench
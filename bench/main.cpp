@@ -0,0 +1,137 @@
+#include "bench.hpp"
+
+#include <charconv>
+#include <fstream>
+#include <iostream>
+#include <print>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+
+// Runs every workload of the matrix and prints one JSON document, so two commits can be compared
+// with a plain diff or a script. Options:
+//   --ops N        tasks per workload (default 200000)
+//   --quick        a reduced matrix for smoke runs
+//   --filter TEXT  only workloads whose name contains TEXT
+//   --out PATH     write the JSON to PATH instead of stdout
+
+using namespace dispatcher::bench;
+
+namespace {
+
+struct Options {
+    size_t ops = 200000;
+    bool quick = false;
+    std::string filter;
+    std::string out;
+};
+
+Options parse(int argc, char **argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        auto value = [&]() -> std::string_view {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for " + std::string(arg));
+            }
+            return argv[++i];
+        };
+        if (arg == "--ops") {
+            auto text = value();
+            auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), options.ops);
+            if (error != std::errc{} || end != text.data() + text.size() || options.ops == 0) {
+                throw std::invalid_argument("--ops must be a positive number");
+            }
+        } else if (arg == "--quick") {
+            options.quick = true;
+        } else if (arg == "--filter") {
+            options.filter = value();
+        } else if (arg == "--out") {
+            options.out = value();
+        } else {
+            throw std::invalid_argument("Unknown option " + std::string(arg));
+        }
+    }
+    return options;
+}
+
+std::vector<Params> matrix(const Options &options) {
+    std::vector<size_t> threads = options.quick ? std::vector<size_t>{1, 2} : std::vector<size_t>{1, 2, 4};
+    std::vector<size_t> sizes = options.quick ? std::vector<size_t>{16} : std::vector<size_t>{16, 256};
+    std::vector<int> mixes = options.quick ? std::vector<int>{10} : std::vector<int>{0, 10, 50};
+    size_t max_workers = std::max<size_t>(1, std::thread::hardware_concurrency());
+
+    std::vector<Params> all;
+    for (size_t producers : threads) {
+        for (size_t consumers : threads) {
+            for (size_t size : sizes) {
+                for (const char *variant : {"bounded", "unbounded", "ring_buffer", "segmented"}) {
+                    all.push_back({"queue", variant, producers, consumers, size, 0, options.ops});
+                }
+                for (int mix : mixes) {
+                    for (const char *variant : {"mutex", "lock_free"}) {
+                        all.push_back({"priority_queue", variant, producers, consumers, size, mix, options.ops});
+                    }
+                    if (consumers <= max_workers) {
+                        for (const char *variant : {"shared", "work_stealing"}) {
+                            all.push_back({"dispatcher", variant, producers, consumers, size, mix, options.ops});
+                        }
+                    }
+                    if (producers == 1 && size == 16 && consumers <= max_workers) {
+                        for (const char *variant : {"chain", "fanout"}) {
+                            all.push_back({"graph", variant, producers, consumers, size, mix, options.ops});
+                        }
+                    }
+                }
+            }
+        }
+    }
+    for (size_t consumers : threads) {
+        if (consumers <= max_workers) {
+            for (const char *variant : {"per_element", "parallel_for"}) {
+                all.push_back({"parallel", variant, 1, consumers, 16, 0, options.ops});
+            }
+        }
+    }
+    return all;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    try {
+        options = parse(argc, argv);
+    } catch (const std::exception &e) {
+        std::println(std::cerr, "{}", e.what());
+        return 2;
+    }
+
+    std::vector<Result> results;
+    for (const auto &params : matrix(options)) {
+        auto name = params.name();
+        if (!options.filter.empty() && name.find(options.filter) == std::string::npos) {
+            continue;
+        }
+        std::println(std::cerr, "running {}", name);
+        if (params.suite == "queue") {
+            results.push_back(run_queue(params));
+        } else if (params.suite == "priority_queue") {
+            results.push_back(run_priority_queue(params));
+        } else if (params.suite == "parallel") {
+            results.push_back(run_parallel(params));
+        } else if (params.suite == "graph") {
+            results.push_back(run_graph(params));
+        } else {
+            results.push_back(run_dispatcher(params));
+        }
+    }
+
+    if (options.out.empty()) {
+        write_json(std::cout, results);
+    } else {
+        std::ofstream file(options.out);
+        write_json(file, results);
+    }
+    return 0;
+}
@@ -0,0 +1,46 @@
+#include "bench.hpp"
+
+#include <thread>
+
+namespace dispatcher::bench {
+
+namespace {
+
+uint64_t percentile(const std::vector<uint64_t> &sorted, double fraction) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    auto index = static_cast<size_t>(fraction * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+}  // namespace
+
+std::string Params::name() const {
+    auto name = suite + "/" + variant + "/p" + std::to_string(producers) + "/c" + std::to_string(consumers) + "/s" +
+                std::to_string(task_size);
+    if (suite != "queue") {
+        name += "/h" + std::to_string(high_percent);
+    }
+    return name;
+}
+
+// one object per line keeps diffs between runs readable
+void write_json(std::ostream &out, const std::vector<Result> &results) {
+    out << "{\n  \"hardware_concurrency\": " << std::thread::hardware_concurrency() << ",\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto &[params, seconds, latencies] = results[i];
+        double ops_per_sec = seconds > 0 ? static_cast<double>(params.ops) / seconds : 0;
+        out << (i == 0 ? "\n" : ",\n") << "    {\"name\": \"" << params.name() << "\", \"suite\": \"" << params.suite
+            << "\", \"variant\": \"" << params.variant << "\", \"producers\": " << params.producers
+            << ", \"consumers\": " << params.consumers << ", \"task_size\": " << params.task_size
+            << ", \"high_percent\": " << params.high_percent << ", \"ops\": " << params.ops
+            << ", \"seconds\": " << seconds << ", \"ops_per_sec\": " << static_cast<uint64_t>(ops_per_sec)
+            << ", \"latency_ns\": {\"p50\": " << percentile(latencies, 0.5)
+            << ", \"p99\": " << percentile(latencies, 0.99) << ", \"p999\": " << percentile(latencies, 0.999)
+            << "}}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+}  // namespace dispatcher::bench
@@ -0,0 +1,245 @@
+#include "bench.hpp"
+#include "parallel.hpp"
+#include "queue/bounded_queue.hpp"
+#include "queue/priority_queue.hpp"
+#include "queue/ring_buffer_queue.hpp"
+#include "queue/segmented_queue.hpp"
+#include "queue/unbounded_queue.hpp"
+#include "task_dispatcher.hpp"
+#include "task_graph.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace dispatcher::bench {
+
+namespace {
+
+constexpr int kQueueCapacity = 1024;
+constexpr size_t kGraphNodes = 1024;
+
+// the task body: record the latency and count the run; Size pads the closure to the requested size
+template <size_t Size>
+Task make_task(LatencyRecorder &recorder, std::atomic<size_t> &done) {
+    struct Padding {
+        std::array<std::byte, Size> bytes{};
+    };
+    return [&recorder, &done, enqueued = Clock::now(), padding = Padding{}]() {
+        recorder.record(enqueued);
+        static_cast<void>(padding);
+        done.fetch_add(1, std::memory_order_relaxed);
+    };
+}
+
+Task make_sized_task(size_t size, LatencyRecorder &recorder, std::atomic<size_t> &done) {
+    switch (size) {
+    case 16:
+        return make_task<16>(recorder, done);
+    case 256:
+        return make_task<256>(recorder, done);
+    default:
+        throw std::invalid_argument("Task size must be 16 or 256");
+    }
+}
+
+// the i-th task goes to High for the first high_percent of every hundred
+TaskPriority pick_priority(size_t i, int high_percent) {
+    return static_cast<int>(i % 100) < high_percent ? TaskPriority::High : TaskPriority::Normal;
+}
+
+// starts `producers` threads that call produce(thread, first, count) for their share of ops
+template <class Produce>
+std::vector<std::jthread> start_producers(const Params &params, Produce produce) {
+    std::vector<std::jthread> producers;
+    size_t share = params.ops / params.producers;
+    for (size_t thread = 0; thread < params.producers; ++thread) {
+        size_t count = thread + 1 == params.producers ? params.ops - share * thread : share;
+        producers.emplace_back([produce, thread, first = share * thread, count]() { produce(thread, first, count); });
+    }
+    return producers;
+}
+
+void wait_for(const std::atomic<size_t> &done, size_t ops) {
+    while (done.load(std::memory_order_relaxed) < ops) {
+        std::this_thread::yield();
+    }
+}
+
+double seconds_since(Clock::time_point start) { return std::chrono::duration<double>(Clock::now() - start).count(); }
+
+}  // namespace
+
+Result run_queue(const Params &params) {
+    std::unique_ptr<queue::IQueue> queue;
+    if (params.variant == "bounded") {
+        queue = std::make_unique<queue::BoundedQueue>(kQueueCapacity);
+    } else if (params.variant == "unbounded") {
+        queue = std::make_unique<queue::UnboundedQueue>();
+    } else if (params.variant == "ring_buffer") {
+        queue = std::make_unique<queue::RingBufferQueue>(kQueueCapacity);
+    } else if (params.variant == "segmented") {
+        queue = std::make_unique<queue::SegmentedQueue>();
+    } else {
+        throw std::invalid_argument("Unknown queue variant " + params.variant);
+    }
+
+    LatencyRecorder recorder(params.ops);
+    std::atomic<size_t> done{0};
+    auto start = Clock::now();
+    {
+        // IQueue has no blocking pop, consumers poll
+        std::vector<std::jthread> consumers;
+        for (size_t i = 0; i < params.consumers; ++i) {
+            consumers.emplace_back([&queue, &done, &params]() {
+                while (done.load(std::memory_order_relaxed) < params.ops) {
+                    if (auto task = queue->try_pop()) {
+                        (*task)();
+                    } else {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+        auto producers = start_producers(params, [&queue, &recorder, &done, &params](size_t, size_t, size_t count) {
+            for (size_t i = 0; i < count; ++i) {
+                queue->push(make_sized_task(params.task_size, recorder, done));
+            }
+        });
+    }
+    return {params, seconds_since(start), recorder.collect()};
+}
+
+Result run_priority_queue(const Params &params) {
+    queue::QueueType high_type = queue::QueueType::Mutex;
+    if (params.variant == "lock_free") {
+        high_type = queue::QueueType::LockFree;
+    } else if (params.variant != "mutex") {
+        throw std::invalid_argument("Unknown priority queue variant " + params.variant);
+    }
+    queue::PriorityQueue pq({{TaskPriority::High, {true, kQueueCapacity, high_type}},
+                             {TaskPriority::Normal, {false, {}}}});
+
+    LatencyRecorder recorder(params.ops);
+    std::atomic<size_t> done{0};
+    auto start = Clock::now();
+    {
+        std::vector<std::jthread> consumers;
+        for (size_t i = 0; i < params.consumers; ++i) {
+            consumers.emplace_back([&pq]() {
+                while (auto task = pq.pop()) {
+                    (*task)();
+                }
+            });
+        }
+        {
+            auto producers =
+                start_producers(params, [&pq, &recorder, &done, &params](size_t, size_t first, size_t count) {
+                    for (size_t i = first; i < first + count; ++i) {
+                        pq.push(pick_priority(i, params.high_percent),
+                                make_sized_task(params.task_size, recorder, done));
+                    }
+                });
+        }
+        wait_for(done, params.ops);
+        pq.shutdown();
+    }
+    return {params, seconds_since(start), recorder.collect()};
+}
+
+Result run_dispatcher(const Params &params) {
+    thread_pool::ThreadPoolOptions options;
+    if (params.variant == "work_stealing") {
+        options.work_stealing = true;
+    } else if (params.variant != "shared") {
+        throw std::invalid_argument("Unknown dispatcher variant " + params.variant);
+    }
+
+    LatencyRecorder recorder(params.ops);
+    std::atomic<size_t> done{0};
+    double seconds;
+    {
+        TaskDispatcher dispatcher(params.consumers,
+                                  {{TaskPriority::High, {true, kQueueCapacity}}, {TaskPriority::Normal, {false, {}}}},
+                                  options);
+        auto start = Clock::now();
+        {
+            auto producers =
+                start_producers(params, [&dispatcher, &recorder, &done, &params](size_t, size_t first, size_t count) {
+                    for (size_t i = first; i < first + count; ++i) {
+                        dispatcher.schedule(pick_priority(i, params.high_percent),
+                                            make_sized_task(params.task_size, recorder, done));
+                    }
+                });
+        }
+        wait_for(done, params.ops);
+        // measured before the dispatcher joins its workers
+        seconds = seconds_since(start);
+    }
+    return {params, seconds, recorder.collect()};
+}
+
+Result run_graph(const Params &params) {
+    if (params.variant != "chain" && params.variant != "fanout") {
+        throw std::invalid_argument("Unknown graph variant " + params.variant);
+    }
+
+    LatencyRecorder recorder(params.ops);
+    Clock::time_point run_start;
+    TaskGraph graph;
+    for (size_t i = 0; i < kGraphNodes; ++i) {
+        auto node = graph.add(pick_priority(i, params.high_percent),
+                              [&recorder, &run_start]() { recorder.record(run_start); });
+        if (i > 0) {
+            graph.precede(params.variant == "chain" ? node - 1 : 0, node);
+        }
+    }
+
+    double seconds;
+    {
+        TaskDispatcher dispatcher(params.consumers,
+                                  {{TaskPriority::High, {true, kQueueCapacity}}, {TaskPriority::Normal, {false, {}}}});
+        auto start = Clock::now();
+        for (size_t done = 0; done < params.ops; done += kGraphNodes) {
+            run_start = Clock::now();
+            graph.run(dispatcher);
+        }
+        seconds = seconds_since(start);
+    }
+    return {params, seconds, recorder.collect()};
+}
+
+Result run_parallel(const Params &params) {
+    if (params.variant != "per_element" && params.variant != "parallel_for") {
+        throw std::invalid_argument("Unknown parallel variant " + params.variant);
+    }
+
+    std::vector<double> x(params.ops, 1.0);
+    std::vector<double> y(params.ops, 2.0);
+    auto axpy = [&x, &y](size_t i) { y[i] += 3.0 * x[i]; };
+    double seconds;
+    {
+        TaskDispatcher dispatcher(params.consumers);
+        auto start = Clock::now();
+        if (params.variant == "parallel_for") {
+            parallel_for(dispatcher, 0, params.ops, axpy);
+        } else {
+            std::atomic<size_t> done{0};
+            for (size_t i = 0; i < params.ops; ++i) {
+                dispatcher.schedule(TaskPriority::Normal, [&axpy, &done, i]() {
+                    axpy(i);
+                    done.fetch_add(1, std::memory_order_relaxed);
+                });
+            }
+            wait_for(done, params.ops);
+        }
+        seconds = seconds_since(start);
+    }
+    // no latencies: the loop is one operation, not a stream of tasks
+    return {params, seconds, {}};
+}
+
+}  // namespace dispatcher::bench
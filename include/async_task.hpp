@@ -0,0 +1,299 @@
+#pragma once
+
+#include "future.hpp"
+#include "task.hpp"
+#include "types.hpp"
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace dispatcher {
+
+template <class T>
+class AsyncTask;
+
+namespace detail {
+
+// Coroutine frames come from the same block pool as oversized task closures.
+struct PooledFrame {
+    static void *operator new(std::size_t size) { return BlockPool::allocate(size); }
+    static void operator delete(void *frame, std::size_t size) noexcept { BlockPool::deallocate(frame, size); }
+};
+
+// Resumption queued on the dispatcher. Owns the frame at the root of the coroutine chain: if the
+// task is dropped (shutdown, a full Reject lane) or the dispatcher throws, the root is destroyed,
+// which destroys every frame it awaits and completes the future of spawn with broken_promise.
+class Resumption {
+public:
+    Resumption(std::coroutine_handle<> handle, std::coroutine_handle<> owner) noexcept
+        : handle_(handle), owner_(owner) {}
+    Resumption(Resumption &&other) noexcept
+        : handle_(std::exchange(other.handle_, nullptr)), owner_(std::exchange(other.owner_, nullptr)) {}
+    Resumption &operator=(Resumption &&) = delete;
+    ~Resumption() {
+        if (owner_) {
+            owner_.destroy();
+        }
+    }
+
+    void operator()() {
+        owner_ = nullptr;
+        std::exchange(handle_, nullptr).resume();
+    }
+
+private:
+    std::coroutine_handle<> handle_;
+    std::coroutine_handle<> owner_;
+};
+
+// Queues the resumption of handle. Returns false if the dispatcher threw, in which case owner,
+// and with it handle, has been destroyed and must not be touched again.
+inline bool schedule_resume(Executor executor, TaskPriority priority, std::coroutine_handle<> handle,
+                            std::coroutine_handle<> owner) noexcept {
+    try {
+        executor.schedule(executor.context, priority, Resumption(handle, owner));
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+class AsyncPromiseBase : public PooledFrame {
+public:
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+
+        template <class Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            auto &promise = handle.promise();
+            if (!promise.continuation_) {
+                return std::noop_coroutine();
+            }
+            if (!promise.executor_.schedule) {
+                return promise.continuation_;
+            }
+            // the awaiting coroutine is resumed from the queue, not inline on this stack; if the
+            // dispatcher throws, the chain this frame belongs to is already gone
+            schedule_resume(promise.executor_, promise.priority_, promise.continuation_, promise.owner_);
+            return std::noop_coroutine();
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    FinalAwaiter final_suspend() noexcept { return {}; }
+
+    void unhandled_exception() noexcept { exception_ = std::current_exception(); }
+
+    void bind(Executor executor, TaskPriority priority) noexcept {
+        executor_ = executor;
+        priority_ = priority;
+    }
+
+    bool bound() const noexcept { return executor_.schedule != nullptr; }
+    Executor executor() const noexcept { return executor_; }
+    TaskPriority priority() const noexcept { return priority_; }
+
+    void set_continuation(std::coroutine_handle<> continuation) noexcept { continuation_ = continuation; }
+
+    // frame at the root of the chain this coroutine runs in, destroyed if a resumption is dropped
+    std::coroutine_handle<> owner() const noexcept { return owner_; }
+    void set_owner(std::coroutine_handle<> owner) noexcept { owner_ = owner; }
+
+protected:
+    std::exception_ptr exception_;
+
+private:
+    std::coroutine_handle<> continuation_;
+    std::coroutine_handle<> owner_;
+    Executor executor_;
+    TaskPriority priority_ = TaskPriority::Normal;
+};
+
+template <class T>
+class AsyncPromise : public AsyncPromiseBase {
+public:
+    AsyncTask<T> get_return_object() noexcept;
+
+    template <class U>
+    void return_value(U &&value) {
+        value_.emplace(std::forward<U>(value));
+    }
+
+    T result() {
+        if (exception_) {
+            std::rethrow_exception(exception_);
+        }
+        return std::move(*value_);
+    }
+
+private:
+    std::optional<T> value_;
+};
+
+template <>
+class AsyncPromise<void> : public AsyncPromiseBase {
+public:
+    AsyncTask<void> get_return_object() noexcept;
+
+    void return_void() noexcept {}
+
+    void result() {
+        if (exception_) {
+            std::rethrow_exception(exception_);
+        }
+    }
+};
+
+// Fire-and-forget coroutine that owns its frame: the frame is freed when the body finishes.
+struct Detached {
+    struct promise_type : PooledFrame {
+        Detached get_return_object() noexcept { return {std::coroutine_handle<promise_type>::from_promise(*this)}; }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+template <class T>
+Detached drive(AsyncTask<T> task, Promise<T> promise);
+
+}  // namespace detail
+
+// Awaitable returned by TaskDispatcher::schedule_on: suspends the coroutine and resumes it
+// on a worker taken from the given priority lane. An AsyncTask that hops this way also queues
+// the resumption of whoever awaits it at that priority.
+class ScheduleAwaiter {
+public:
+    ScheduleAwaiter(detail::Executor executor, TaskPriority priority) noexcept
+        : executor_(executor), priority_(priority) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    template <class Promise>
+    void await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+        std::coroutine_handle<> owner = handle;
+        if constexpr (std::is_base_of_v<detail::AsyncPromiseBase, Promise>) {
+            handle.promise().bind(executor_, priority_);
+            owner = handle.promise().owner();
+        }
+        detail::schedule_resume(executor_, priority_, handle, owner);
+    }
+
+    void await_resume() const noexcept {}
+
+private:
+    detail::Executor executor_;
+    TaskPriority priority_;
+};
+
+// Lazily started coroutine producing a T. It runs when awaited (or when handed to
+// TaskDispatcher::spawn); once it is bound to a dispatcher, the awaiting coroutine is resumed
+// through the PriorityQueue rather than inline, so long chains never grow a worker's stack and
+// never block a worker thread.
+template <class T = void>
+class [[nodiscard]] AsyncTask {
+public:
+    using promise_type = detail::AsyncPromise<T>;
+
+    AsyncTask(AsyncTask &&other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+    AsyncTask &operator=(AsyncTask &&other) noexcept {
+        if (this != &other) {
+            reset();
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+    AsyncTask(const AsyncTask &) = delete;
+    AsyncTask &operator=(const AsyncTask &) = delete;
+
+    ~AsyncTask() { reset(); }
+
+    bool await_ready() const noexcept { return false; }
+
+    template <class Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> awaiting) noexcept {
+        auto &promise = handle_.promise();
+        if constexpr (std::is_base_of_v<detail::AsyncPromiseBase, Promise>) {
+            if (!promise.bound() && awaiting.promise().bound()) {
+                promise.bind(awaiting.promise().executor(), awaiting.promise().priority());
+            }
+            if (!promise.owner()) {
+                promise.set_owner(awaiting.promise().owner());
+            }
+        }
+        // awaited from outside an AsyncTask chain: the awaiting coroutine is the root
+        if (!promise.owner()) {
+            promise.set_owner(awaiting);
+        }
+        promise.set_continuation(awaiting);
+        return handle_;
+    }
+
+    T await_resume() { return handle_.promise().result(); }
+
+private:
+    friend class detail::AsyncPromise<T>;
+    friend class TaskDispatcher;
+
+    explicit AsyncTask(std::coroutine_handle<promise_type> handle) noexcept : handle_(handle) {}
+
+    void reset() noexcept {
+        if (handle_) {
+            std::exchange(handle_, nullptr).destroy();
+        }
+    }
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+namespace detail {
+
+template <class T>
+AsyncTask<T> AsyncPromise<T>::get_return_object() noexcept {
+    return AsyncTask<T>(std::coroutine_handle<AsyncPromise<T>>::from_promise(*this));
+}
+
+inline AsyncTask<void> AsyncPromise<void>::get_return_object() noexcept {
+    return AsyncTask<void>(std::coroutine_handle<AsyncPromise<void>>::from_promise(*this));
+}
+
+template <class T>
+Detached drive(AsyncTask<T> task, Promise<T> promise) {
+    std::exception_ptr exception;
+    if constexpr (std::is_void_v<T>) {
+        try {
+            co_await std::move(task);
+        } catch (...) {
+            exception = std::current_exception();
+        }
+        if (!exception) {
+            promise.set_value();
+        }
+    } else {
+        std::optional<T> value;
+        try {
+            value.emplace(co_await std::move(task));
+        } catch (...) {
+            exception = std::current_exception();
+        }
+        if (!exception) {
+            promise.set_value(std::move(*value));
+        }
+    }
+    if (exception) {
+        promise.set_exception(std::move(exception));
+    }
+}
+
+}  // namespace detail
+
+}  // namespace dispatcher
@@ -0,0 +1,306 @@
+#pragma once
+
+#include "task.hpp"
+#include "types.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace dispatcher {
+
+template <class T>
+class Future;
+
+namespace detail {
+
+// where continuations attached with Future::then are scheduled
+struct Executor {
+    void *context = nullptr;
+    void (*schedule)(void *context, TaskPriority priority, Task task) = nullptr;
+};
+
+// Result slot shared by a Future and the task producing its value. States come from
+// detail::BlockPool, so a submit recycles the state of an earlier one instead of allocating.
+// Waiting is an atomic wait on the status word: no mutex or condition variable per task.
+template <class T>
+class SharedState {
+public:
+    using Value = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+    // returns a state with two references: one for the future, one for the producer
+    static SharedState *create(Executor executor, TaskPriority priority) {
+        void *block;
+        if constexpr (alignof(SharedState) > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            block = ::operator new(sizeof(SharedState), std::align_val_t{alignof(SharedState)});
+        } else {
+            block = BlockPool::allocate(sizeof(SharedState));
+        }
+        return ::new (block) SharedState(executor, priority);
+    }
+
+    void release() noexcept {
+        if (refs_.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+            return;
+        }
+        this->~SharedState();
+        if constexpr (alignof(SharedState) > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            ::operator delete(static_cast<void *>(this), std::align_val_t{alignof(SharedState)});
+        } else {
+            BlockPool::deallocate(this, sizeof(SharedState));
+        }
+    }
+
+    // the result is stored first and published by complete(), which also fires the continuation
+    template <class... Args>
+    void emplace_value(Args &&...args) {
+        value_.emplace(std::forward<Args>(args)...);
+    }
+
+    void store_exception(std::exception_ptr exception) noexcept { exception_ = std::move(exception); }
+
+    void complete() {
+        uint32_t previous = status_.fetch_or(kReady, std::memory_order_acq_rel);
+        status_.notify_all();
+        if (previous & kContinuation) {
+            schedule_continuation();
+        }
+    }
+
+    bool is_ready() const noexcept { return status_.load(std::memory_order_acquire) & kReady; }
+
+    void wait() const noexcept {
+        uint32_t status = status_.load(std::memory_order_acquire);
+        while (!(status & kReady)) {
+            status_.wait(status, std::memory_order_acquire);
+            status = status_.load(std::memory_order_acquire);
+        }
+    }
+
+    // precondition: is_ready()
+    bool has_exception() const noexcept { return exception_ != nullptr; }
+    std::exception_ptr exception() const noexcept { return exception_; }
+    Value &value() noexcept { return *value_; }
+
+    // continuation runs as a task on the executor as soon as the value is set (or right away if it already is)
+    void set_continuation(TaskPriority priority, Task continuation) {
+        continuation_ = std::move(continuation);
+        continuation_priority_ = priority;
+        if (status_.fetch_or(kContinuation, std::memory_order_acq_rel) & kReady) {
+            schedule_continuation();
+        }
+    }
+
+    Executor executor() const noexcept { return executor_; }
+    // priority the producing task was scheduled with
+    TaskPriority priority() const noexcept { return priority_; }
+
+private:
+    static constexpr uint32_t kReady = 1;
+    static constexpr uint32_t kContinuation = 2;
+
+    SharedState(Executor executor, TaskPriority priority) : priority_(priority), executor_(executor) {}
+
+    void schedule_continuation() {
+        executor_.schedule(executor_.context, continuation_priority_, std::move(continuation_));
+    }
+
+    std::atomic<uint32_t> status_{0};
+    std::atomic<uint32_t> refs_{2};
+    std::optional<Value> value_;
+    std::exception_ptr exception_;
+    Task continuation_;
+    TaskPriority continuation_priority_ = TaskPriority::Normal;
+    TaskPriority priority_;
+    Executor executor_;
+};
+
+// owns one reference to a shared state
+template <class T>
+class StateRef {
+public:
+    explicit StateRef(SharedState<T> *state) noexcept : state_(state) {}
+    StateRef(StateRef &&other) noexcept : state_(std::exchange(other.state_, nullptr)) {}
+    StateRef &operator=(StateRef &&) = delete;
+    ~StateRef() {
+        if (state_) {
+            state_->release();
+        }
+    }
+
+    SharedState<T> *operator->() const noexcept { return state_; }
+
+private:
+    SharedState<T> *state_;
+};
+
+// Producer side of a shared state. Destroying it unsatisfied (e.g. the task was dropped on shutdown)
+// completes the future with std::future_errc::broken_promise.
+template <class T>
+class Promise {
+public:
+    explicit Promise(SharedState<T> *state) noexcept : state_(state) {}
+
+    Promise(Promise &&other) noexcept : state_(std::exchange(other.state_, nullptr)) {}
+    Promise &operator=(Promise &&) = delete;
+    Promise(const Promise &) = delete;
+    Promise &operator=(const Promise &) = delete;
+
+    ~Promise() {
+        if (state_) {
+            set_exception(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+        }
+    }
+
+    // invokes callable and stores its result or the exception it threw
+    template <class F, class... Args>
+    void set_from(F &callable, Args &&...args) {
+        StateRef<T> state{std::exchange(state_, nullptr)};
+        try {
+            if constexpr (std::is_void_v<T>) {
+                std::invoke(callable, std::forward<Args>(args)...);
+                state->emplace_value();
+            } else {
+                state->emplace_value(std::invoke(callable, std::forward<Args>(args)...));
+            }
+        } catch (...) {
+            state->store_exception(std::current_exception());
+        }
+        state->complete();
+    }
+
+    template <class... Args>
+    void set_value(Args &&...args) {
+        StateRef<T> state{std::exchange(state_, nullptr)};
+        try {
+            state->emplace_value(std::forward<Args>(args)...);
+        } catch (...) {
+            state->store_exception(std::current_exception());
+        }
+        state->complete();
+    }
+
+    void set_exception(std::exception_ptr exception) {
+        StateRef<T> state{std::exchange(state_, nullptr)};
+        state->store_exception(std::move(exception));
+        state->complete();
+    }
+
+private:
+    SharedState<T> *state_;
+};
+
+template <class T>
+std::pair<Future<T>, Promise<T>> make_future(Executor executor, TaskPriority priority) {
+    auto *state = SharedState<T>::create(executor, priority);
+    return {Future<T>(state), Promise<T>(state)};
+}
+
+template <class Callable, class T>
+struct continuation_result {
+    using type = std::invoke_result_t<Callable &, T>;
+};
+
+template <class Callable>
+struct continuation_result<Callable, void> {
+    using type = std::invoke_result_t<Callable &>;
+};
+
+}  // namespace detail
+
+// Result of TaskDispatcher::submit. Move-only, get() may be called once.
+template <class T>
+class Future {
+public:
+    Future() noexcept = default;
+
+    Future(Future &&other) noexcept : state_(std::exchange(other.state_, nullptr)) {}
+    Future &operator=(Future &&other) noexcept {
+        if (this != &other) {
+            reset();
+            state_ = std::exchange(other.state_, nullptr);
+        }
+        return *this;
+    }
+    Future(const Future &) = delete;
+    Future &operator=(const Future &) = delete;
+
+    ~Future() { reset(); }
+
+    bool valid() const noexcept { return state_ != nullptr; }
+    bool is_ready() const { return checked_state()->is_ready(); }
+    void wait() const { checked_state()->wait(); }
+
+    T get() {
+        checked_state()->wait();
+        detail::StateRef<T> state{std::exchange(state_, nullptr)};
+        if (state->has_exception()) {
+            std::rethrow_exception(state->exception());
+        }
+        if constexpr (!std::is_void_v<T>) {
+            return std::move(state->value());
+        }
+    }
+
+    // Schedules callable(value) on the dispatcher once this future is ready, without blocking a thread.
+    // An exception stored in this future skips callable and is passed on to the returned future.
+    // Invalidates this future.
+    template <class F>
+    auto then(TaskPriority priority, F &&callable) {
+        using Callable = std::decay_t<F>;
+        using Result = typename detail::continuation_result<Callable, T>::type;
+
+        auto *state = checked_state();
+        auto [future, promise] = detail::make_future<Result>(state->executor(), priority);
+        state->set_continuation(priority, [previous = detail::StateRef<T>(std::exchange(state_, nullptr)),
+                                           promise = std::move(promise),
+                                           callable = Callable(std::forward<F>(callable))]() mutable {
+            if (previous->has_exception()) {
+                promise.set_exception(previous->exception());
+            } else if constexpr (std::is_void_v<T>) {
+                promise.set_from(callable);
+            } else {
+                promise.set_from(callable, std::move(previous->value()));
+            }
+        });
+        return std::move(future);
+    }
+
+    // runs the continuation with the priority the producing task had
+    template <class F>
+    auto then(F &&callable) {
+        return then(checked_state()->priority(), std::forward<F>(callable));
+    }
+
+private:
+    template <class U>
+    friend std::pair<Future<U>, detail::Promise<U>> detail::make_future(detail::Executor executor,
+                                                                         TaskPriority priority);
+
+    explicit Future(detail::SharedState<T> *state) noexcept : state_(state) {}
+
+    detail::SharedState<T> *checked_state() const {
+        if (!state_) {
+            throw std::future_error(std::future_errc::no_state);
+        }
+        return state_;
+    }
+
+    void reset() noexcept {
+        if (state_) {
+            std::exchange(state_, nullptr)->release();
+        }
+    }
+
+    detail::SharedState<T> *state_ = nullptr;
+};
+
+}  // namespace dispatcher
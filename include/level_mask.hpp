@@ -0,0 +1,53 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+
+namespace dispatcher {
+
+// Bitmap of priority levels that may hold work, so the highest non-empty level is found with one
+// load and a count-trailing-zeros instead of probing every level.
+// A level's bit is set after its pending counter is incremented and cleared only when the counter
+// drops to zero, with a re-check afterwards, so a bit may be stale-set but never stale-clear.
+class LevelMask {
+public:
+    using Bits = std::uint32_t;
+
+    static_assert(kTaskPriorityCount <= sizeof(Bits) * 8, "LevelMask needs a bit per priority level");
+
+    static std::size_t first(Bits bits) noexcept { return static_cast<std::size_t>(std::countr_zero(bits)); }
+
+    Bits load() const noexcept { return bits_.load(); }
+
+    // call after incrementing the level's counter
+    void mark(std::size_t level) noexcept {
+        Bits bit = Bits{1} << level;
+        if (!(bits_.load() & bit)) {
+            bits_.fetch_or(bit);
+        }
+    }
+
+    // Call once the level's counter was seen at zero. Returns true when work arrived in the
+    // meantime and the bit had to be restored: whoever may have slept on the cleared bit
+    // must then be woken up by the caller.
+    template <class Counter>
+    bool clear(std::size_t level, const Counter &pending) noexcept {
+        Bits bit = Bits{1} << level;
+        if (!(bits_.load() & bit)) {
+            return false;
+        }
+        bits_.fetch_and(~bit);
+        if (pending.load() > 0) {
+            return !(bits_.fetch_or(bit) & bit);
+        }
+        return false;
+    }
+
+private:
+    std::atomic<Bits> bits_{0};
+};
+
+}  // namespace dispatcher
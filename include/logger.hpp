@@ -1,9 +1,87 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <cstdio>
+#include <format>
+#include <iterator>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// what a full per-thread buffer does with a new line
+enum class LogOverflow {
+    Drop,   // the line is discarded and counted in Dropped()
+    Block,  // the logging thread waits for the flusher
+};
+
+struct AsyncLogOptions {
+    // appended to; stdout when empty
+    std::optional<std::string> path = std::nullopt;
+    // bytes buffered per logging thread, lines longer than that are written directly
+    size_t buffer_size = 64 * 1024;
+    LogOverflow overflow = LogOverflow::Drop;
+    // longest time a line sits in a buffer
+    std::chrono::milliseconds flush_interval{10};
+};
+
+// Asynchronous backend of Logger. Every logging thread copies its lines into its own
+// single-producer ring buffer; one flusher thread drains all rings with batched writev,
+// so a log call costs a memcpy instead of a write(2) and threads never share a lock.
+// Lines of one thread keep their order, lines of different threads are not interleaved.
+class AsyncLogWriter {
+public:
+    explicit AsyncLogWriter(AsyncLogOptions options = {});
+
+    AsyncLogWriter(const AsyncLogWriter &) = delete;
+    AsyncLogWriter &operator=(const AsyncLogWriter &) = delete;
+
+    // writes out everything logged so far and stops the flusher; nothing may be logged concurrently
+    ~AsyncLogWriter();
+
+    // appends message and a newline
+    void Write(std::string_view message);
+    // returns once every line written before the call is handed to the file
+    void Flush();
+    size_t Dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    struct Buffer;
+
+    Buffer &LocalBuffer();
+    void WakeFlusher();
+    void FlusherFunction();
+    void Drain(const std::vector<std::shared_ptr<Buffer>> &buffers);
+    void WriteDirect(std::string_view message);
+
+    AsyncLogOptions options_;
+    int fd_;
+    bool owns_fd_ = false;
+    // tells the thread-local buffer caches of different writers apart
+    const uint64_t id_;
+
+    std::mutex buffers_mutex_;
+    std::vector<std::shared_ptr<Buffer>> buffers_;
+
+    std::mutex flusher_mutex_;
+    std::condition_variable flusher_cv_;
+    std::condition_variable flushed_cv_;
+    bool wake_ = false;
+    bool stop_ = false;
+    uint64_t flush_requested_ = 0;
+    uint64_t flush_done_ = 0;
+
+    // serializes the flusher's writev with direct writes of oversized lines
+    std::mutex write_mutex_;
+    std::atomic<size_t> dropped_{0};
+    std::jthread flusher_;
+};
 
 class Logger {
 public:
@@ -12,11 +90,47 @@ public:
         return instance;
     }
 
-    void Log(const std::string &message) { fprintf(file_, "%s\n", message.c_str()); }
+    void Log(std::string_view message) {
+        if (auto *async = async_.load(std::memory_order_acquire)) {
+            async->Write(message);
+        } else {
+            fprintf(file_, "%.*s\n", static_cast<int>(message.size()), message.data());
+        }
+    }
+
+    template <class... Args>
+        requires(sizeof...(Args) > 0)
+    void Log(std::format_string<Args...> format, Args &&...args) {
+        thread_local std::string line;
+        line.clear();
+        std::format_to(std::back_inserter(line), format, std::forward<Args>(args)...);
+        Log(std::string_view(line));
+    }
+
+    // Switches to asynchronous logging. Call before logging starts, not concurrently with Log.
+    void EnableAsync(AsyncLogOptions options = {}) {
+        auto async = std::make_unique<AsyncLogWriter>(std::move(options));
+        Shutdown();
+        async_.store(async.release(), std::memory_order_release);
+    }
+
+    void Flush() {
+        if (auto *async = async_.load(std::memory_order_acquire)) {
+            async->Flush();
+        }
+    }
+
+    size_t Dropped() const {
+        auto *async = async_.load(std::memory_order_acquire);
+        return async ? async->Dropped() : 0;
+    }
+
+    // flushes and goes back to synchronous logging; call once logging has stopped
+    void Shutdown() { delete async_.exchange(nullptr, std::memory_order_acq_rel); }
 
     Logger(const Logger &) = delete;
     Logger &operator=(const Logger &) = delete;
-    ~Logger() = default;
+    ~Logger() { Shutdown(); }
 
 private:
     Logger() {
@@ -26,4 +140,5 @@ private:
     }
 
     FILE *file_;
+    std::atomic<AsyncLogWriter *> async_{nullptr};
 };
@@ -0,0 +1,237 @@
+#pragma once
+
+#include "level_mask.hpp"
+#include "task.hpp"
+#include "types.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace dispatcher::metrics {
+
+// false when built with -DDISPATCHER_METRICS=OFF: every record call below is then empty and
+// snapshots only carry the lane depths, which the queue tracks anyway
+inline constexpr bool kEnabled = DISPATCHER_METRICS != 0;
+
+inline std::int64_t now_ns() noexcept {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// Copy of a Histogram. Values are bucketed HDR-style: exact below kSubBuckets, above that every
+// power of two is split into kSubBuckets linear buckets, so any value is off by at most 1/kSubBuckets.
+struct HistogramSnapshot {
+    static constexpr std::size_t kSubBits = 3;
+    static constexpr std::size_t kSubBuckets = std::size_t{1} << kSubBits;
+    static constexpr std::size_t kBuckets = (64 - kSubBits + 1) * kSubBuckets;
+
+    static std::size_t bucket_of(std::uint64_t value) noexcept {
+        if (value < kSubBuckets) {
+            return static_cast<std::size_t>(value);
+        }
+        std::size_t magnitude = std::bit_width(value) - 1;
+        std::size_t sub = (value >> (magnitude - kSubBits)) & (kSubBuckets - 1);
+        return (magnitude - kSubBits + 1) * kSubBuckets + sub;
+    }
+    static std::uint64_t lower_bound(std::size_t bucket) noexcept;
+    static std::uint64_t upper_bound(std::size_t bucket) noexcept;
+
+    std::uint64_t count() const;
+    // upper bound of the bucket holding the q-th quantile (0 <= q <= 1), 0 when empty
+    std::uint64_t percentile(double q) const;
+    std::uint64_t max() const { return percentile(1.0); }
+    void merge(const HistogramSnapshot &other);
+
+    std::array<std::uint64_t, kBuckets> buckets{};
+};
+
+class Counter {
+public:
+    void add(std::uint64_t n) noexcept { value_.fetch_add(n, std::memory_order_relaxed); }
+    std::uint64_t load() const noexcept { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<std::uint64_t> value_{0};
+};
+
+// Histogram of nanosecond durations, see HistogramSnapshot for the bucketing.
+class Histogram {
+public:
+    void record(std::uint64_t value) noexcept {
+        buckets_[HistogramSnapshot::bucket_of(value)].fetch_add(1, std::memory_order_relaxed);
+    }
+    void add_to(HistogramSnapshot &snapshot) const;
+
+private:
+    std::array<std::atomic<std::uint64_t>, HistogramSnapshot::kBuckets> buckets_{};
+};
+
+struct LaneSnapshot {
+    TaskPriority priority;
+    std::uint64_t enqueued = 0;
+    std::uint64_t dequeued = 0;
+    // tasks the lane refused: pushed after shutdown, timed out, or turned away by the overflow policy
+    std::uint64_t rejected = 0;
+    // queued tasks thrown away to make room, OverflowPolicy::DropOldest
+    std::uint64_t dropped = 0;
+    // tasks handed on to the divert lane, OverflowPolicy::Divert; counted as enqueued there
+    std::uint64_t diverted = 0;
+    // tasks of a QueueType::Deadline lane discarded because their deadline passed before they ran
+    std::uint64_t expired = 0;
+    // tasks waiting right now, in the shared lane and in workers' deques
+    std::int64_t depth = 0;
+    // time from enqueue to dequeue, nanoseconds
+    HistogramSnapshot wait_time;
+};
+
+struct WorkerSnapshot {
+    std::chrono::nanoseconds busy{0};
+    std::chrono::nanoseconds idle{0};
+    std::uint64_t tasks = 0;
+};
+
+struct Snapshot {
+    // configured lanes, highest priority first
+    std::vector<LaneSnapshot> lanes;
+    std::vector<WorkerSnapshot> workers;
+    // time spent running a task, nanoseconds
+    HistogramSnapshot run_time;
+};
+
+// Time accounting of one worker thread; only that thread records into it.
+class WorkerMetrics {
+public:
+    // the worker starts idling now
+    void start() noexcept {
+#if DISPATCHER_METRICS
+        since_ = now_ns();
+#endif
+    }
+    // returns the task start timestamp to pass to end_task
+    std::int64_t begin_task() noexcept {
+#if DISPATCHER_METRICS
+        auto now = now_ns();
+        idle_.add(static_cast<std::uint64_t>(now - since_));
+        return now;
+#else
+        return 0;
+#endif
+    }
+    void end_task([[maybe_unused]] std::int64_t started) noexcept {
+#if DISPATCHER_METRICS
+        since_ = now_ns();
+        auto took = static_cast<std::uint64_t>(since_ - started);
+        busy_.add(took);
+        tasks_.add(1);
+        run_time_.record(took);
+#endif
+    }
+
+private:
+    friend class Metrics;
+
+    Counter busy_;
+    Counter idle_;
+    Counter tasks_;
+    Histogram run_time_;
+    std::int64_t since_ = 0;
+};
+
+// Counters of one dispatcher. Every thread records into one of kShards stripes picked once per
+// thread, so producers and workers rarely share a cache line and an update is an uncontended
+// relaxed add; snapshot() sums the stripes. Nothing is allocated after the lanes are added.
+class Metrics {
+public:
+    static constexpr std::size_t kShards = 16;
+
+    Metrics() = default;
+    Metrics(const Metrics &) = delete;
+    Metrics &operator=(const Metrics &) = delete;
+
+    // allocates the counters of a level; call for every configured level before recording
+    void add_lane(std::size_t level);
+
+    // sets the enqueue time the wait of the tasks is measured from; call before handing them to a queue
+    static void stamp([[maybe_unused]] std::span<Task> tasks) noexcept {
+#if DISPATCHER_METRICS
+        auto now = now_ns();
+        for (auto &task : tasks) {
+            task.set_enqueued_at(now);
+        }
+#endif
+    }
+    void enqueued([[maybe_unused]] std::size_t level, [[maybe_unused]] std::size_t count) {
+#if DISPATCHER_METRICS
+        shard().lane(level).enqueued.add(count);
+#endif
+    }
+    void dequeued([[maybe_unused]] std::size_t level, [[maybe_unused]] const Task &task) {
+#if DISPATCHER_METRICS
+        auto &lane = shard().lane(level);
+        lane.dequeued.add(1);
+        lane.wait_time.record(static_cast<std::uint64_t>(std::max<std::int64_t>(now_ns() - task.enqueued_at(), 0)));
+#endif
+    }
+    void rejected([[maybe_unused]] std::size_t level, [[maybe_unused]] std::size_t count) {
+#if DISPATCHER_METRICS
+        if (count > 0) {
+            shard().lane(level).rejected.add(count);
+        }
+#endif
+    }
+    void dropped([[maybe_unused]] std::size_t level, [[maybe_unused]] std::size_t count) {
+#if DISPATCHER_METRICS
+        shard().lane(level).dropped.add(count);
+#endif
+    }
+    void diverted([[maybe_unused]] std::size_t level, [[maybe_unused]] std::size_t count) {
+#if DISPATCHER_METRICS
+        shard().lane(level).diverted.add(count);
+#endif
+    }
+    void expired([[maybe_unused]] std::size_t level, [[maybe_unused]] std::size_t count) {
+#if DISPATCHER_METRICS
+        shard().lane(level).expired.add(count);
+#endif
+    }
+
+    // creates the accounting of workers [0, count); call before the workers start
+    void add_workers(std::size_t count);
+    WorkerMetrics &worker(std::size_t index) { return *workers_[index]; }
+
+    // counters of the given levels and of every worker; depths are left at zero for the caller
+    Snapshot snapshot(LevelMask::Bits levels) const;
+
+private:
+    struct LaneCounters {
+        Counter enqueued;
+        Counter dequeued;
+        Counter rejected;
+        Counter dropped;
+        Counter diverted;
+        Counter expired;
+        Histogram wait_time;
+    };
+
+    struct alignas(kCacheLineSize) Shard {
+        // only configured levels get counters
+        std::array<std::unique_ptr<LaneCounters>, kTaskPriorityCount> lanes;
+
+        LaneCounters &lane(std::size_t level) { return *lanes[level]; }
+    };
+
+    static std::size_t shard_index() noexcept;
+    Shard &shard() noexcept { return shards_[shard_index()]; }
+
+    std::array<Shard, kShards> shards_;
+    std::vector<std::unique_ptr<WorkerMetrics>> workers_;
+};
+
+}  // namespace dispatcher::metrics
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "task_dispatcher.hpp"
+#include "types.hpp"
+
+#include <concepts>
+#include <cstddef>
+#include <optional>
+#include <ranges>
+#include <utility>
+#include <vector>
+
+namespace dispatcher {
+
+namespace detail {
+
+// a borrowed loop body: runs indices [begin, end) on behalf of participant
+struct ChunkBody {
+    void *context = nullptr;
+    void (*run)(void *context, size_t participant, size_t begin, size_t end) = nullptr;
+};
+
+template <class F>
+ChunkBody chunk_body(F &body) {
+    return {&body, [](void *context, size_t participant, size_t begin, size_t end) {
+                (*static_cast<F *>(context))(participant, begin, end);
+            }};
+}
+
+// Drives the loops below. Participants claim chunks from a shared cursor, each chunk a
+// 1/(2 * participants) share of what is left but at least grain indices: large chunks while there
+// is plenty of work, small ones at the end so that nobody is left with a long tail. The calling
+// thread is participant 0, up to one helper task per worker joins in; a helper that starts after
+// the work is gone returns at once.
+class ParallelLoop {
+public:
+    // participants the loop may use, so that per-participant state can be sized up front
+    static size_t max_participants(const TaskDispatcher &dispatcher);
+    // returns once every index has run; rethrows the first exception of the body, indices not
+    // claimed by then are skipped
+    static void run(TaskDispatcher &dispatcher, size_t first, size_t last, TaskPriority priority, size_t grain,
+                    size_t participants, ChunkBody body);
+};
+
+}  // namespace detail
+
+// Calls body(i) for every i in [first, last), spread over the dispatcher's workers and the calling
+// thread, which takes part and returns when all calls are done. body is called concurrently.
+// grain is the smallest number of indices handed out at once.
+template <class Body>
+    requires std::invocable<Body &, size_t>
+void parallel_for(TaskDispatcher &dispatcher, size_t first, size_t last, Body &&body,
+                  TaskPriority priority = TaskPriority::Normal, size_t grain = 1) {
+    auto chunk = [&body](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            body(i);
+        }
+    };
+    detail::ParallelLoop::run(dispatcher, first, last, priority, grain,
+                              detail::ParallelLoop::max_participants(dispatcher), detail::chunk_body(chunk));
+}
+
+// calls body(element) for every element of the range, see parallel_for above
+template <std::ranges::random_access_range Range, class Body>
+    requires std::ranges::sized_range<Range> && std::invocable<Body &, std::ranges::range_reference_t<Range>>
+void parallel_for(TaskDispatcher &dispatcher, Range &&range, Body &&body, TaskPriority priority = TaskPriority::Normal,
+                  size_t grain = 1) {
+    auto begin = std::ranges::begin(range);
+    parallel_for(
+        dispatcher, 0, static_cast<size_t>(std::ranges::size(range)), [&body, begin](size_t i) { body(begin[i]); },
+        priority, grain);
+}
+
+// Folds [first, last): every participant folds the chunks it claims with
+// accumulator = reduce(std::move(accumulator), i), starting from identity, and the partial results
+// are combined with join. Chunks go to participants in no fixed order, so join has to be
+// associative and commutative and identity neutral for it.
+template <class T, class Reduce, class Join>
+    requires std::convertible_to<std::invoke_result_t<Reduce &, T, size_t>, T> &&
+             std::convertible_to<std::invoke_result_t<Join &, T, T>, T>
+T parallel_reduce(TaskDispatcher &dispatcher, size_t first, size_t last, T identity, Reduce &&reduce, Join &&join,
+                  TaskPriority priority = TaskPriority::Normal, size_t grain = 1) {
+    size_t participants = detail::ParallelLoop::max_participants(dispatcher);
+    std::vector<std::optional<T>> partials(participants);
+    auto chunk = [&](size_t participant, size_t begin, size_t end) {
+        T accumulator = identity;
+        for (size_t i = begin; i < end; ++i) {
+            accumulator = reduce(std::move(accumulator), i);
+        }
+        auto &partial = partials[participant];
+        if (partial) {
+            partial = join(std::move(*partial), std::move(accumulator));
+        } else {
+            partial.emplace(std::move(accumulator));
+        }
+    };
+    detail::ParallelLoop::run(dispatcher, first, last, priority, grain, participants, detail::chunk_body(chunk));
+
+    T result = std::move(identity);
+    for (auto &partial : partials) {
+        if (partial) {
+            result = join(std::move(result), std::move(*partial));
+        }
+    }
+    return result;
+}
+
+}  // namespace dispatcher
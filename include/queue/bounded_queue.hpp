@@ -10,14 +10,18 @@ class BoundedQueue : public IQueue {
 public:
     explicit BoundedQueue(int capacity);
 
-    void push(std::function<void()> task) override;
+    void push(Task task) override;
 
-    std::optional<std::function<void()>> try_pop() override;
+    std::optional<Task> try_pop() override;
+
+    size_t try_push_bulk(std::span<Task> tasks) override;
+
+    bool push_until(Task &task, std::chrono::steady_clock::time_point deadline) override;
 
     ~BoundedQueue() override;
 
 private:
-    std::queue<std::function<void()>> queue_;
+    std::queue<Task> queue_;
     std::mutex mutex_;
     std::condition_variable not_empty_;
     std::condition_variable not_full_;
@@ -0,0 +1,68 @@
+#pragma once
+#include "queue/queue.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace dispatcher::queue {
+
+// Unbounded queue that hands out the task with the earliest deadline first (EDF); tasks with equal
+// deadlines, and tasks pushed through the plain IQueue calls, which have none, leave in FIFO order
+// after every task that has one. A task whose deadline has passed is never returned: try_pop
+// discards it and counts it for take_expired.
+//
+// Ordering is a 4-ary min-heap of small keys, so a sift touches about half as many levels as a
+// binary heap and the children of a node share one or two cache lines; the tasks themselves stay
+// in a slot array and are never moved by a sift.
+class DeadlineQueue : public IQueue {
+public:
+    DeadlineQueue() = default;
+
+    // no deadline: runs after every task that has one
+    void push(Task task) override;
+
+    // deadline is in steady clock nanoseconds, see metrics::now_ns
+    void push(Task task, int64_t deadline);
+
+    std::optional<Task> try_pop() override;
+
+    size_t try_push_bulk(std::span<Task> tasks) override;
+
+    bool push_until(Task &task, std::chrono::steady_clock::time_point deadline) override;
+
+    // tasks discarded by try_pop since the last call
+    size_t take_expired();
+
+    ~DeadlineQueue() override;
+
+private:
+    static constexpr size_t kArity = 4;
+    static constexpr int64_t kNoDeadline = INT64_MAX;
+
+    struct Key {
+        int64_t deadline;
+        // push order, breaks ties between equal deadlines
+        uint64_t sequence;
+        uint32_t slot;
+
+        bool operator<(const Key &other) const {
+            return deadline != other.deadline ? deadline < other.deadline : sequence < other.sequence;
+        }
+    };
+
+    void insert(Task &task, int64_t deadline);
+    Task extract();
+    void sift_up(size_t index);
+    void sift_down(size_t index);
+
+    std::mutex mutex_;
+    std::vector<Key> heap_;
+    std::vector<Task> slots_;
+    std::vector<uint32_t> free_slots_;
+    uint64_t next_sequence_ = 0;
+    std::atomic<size_t> expired_{0};
+};
+
+}  // namespace dispatcher::queue
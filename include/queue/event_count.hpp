@@ -0,0 +1,39 @@
+#pragma once
+#include "types.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace dispatcher::queue {
+
+// Lets consumers sleep until a condition they check themselves becomes true, without a mutex:
+//
+//     auto key = event_count.prepare_wait();
+//     if (condition()) { event_count.cancel_wait(); } else { event_count.wait(key); }
+//
+// A notify issued after the condition was made true either finds the waiter registered and
+// bumps the epoch it sleeps on, or happens early enough that the re-check sees the condition.
+// Notifiers do not touch the futex at all while nobody is registered.
+class EventCount {
+public:
+    using Key = uint32_t;
+
+    Key prepare_wait();
+    void cancel_wait();
+    void wait(Key key);
+    // like wait, but gives up at deadline; returns false if it did
+    bool wait_until(Key key, std::chrono::steady_clock::time_point deadline);
+
+    void notify_one();
+    // wakes up to count waiters
+    void notify(size_t count);
+    void notify_all();
+
+private:
+    void wake(int count);
+
+    alignas(kCacheLineSize) std::atomic<uint32_t> epoch_{0};
+    alignas(kCacheLineSize) std::atomic<uint32_t> waiters_{0};
+};
+
+}  // namespace dispatcher::queue
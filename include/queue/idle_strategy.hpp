@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <thread>
+
+namespace dispatcher::queue {
+
+// tells the CPU this is a spin-wait loop: saves power and lets the other hyper-thread run
+inline void cpu_relax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// How a consumer that found no work waits before it parks on the futex: first `spins` re-checks
+// with a pause in between, then `yields` re-checks giving the CPU away each time. A consumer that
+// is still spinning picks new work up within a few hundred nanoseconds and costs the producer no
+// wake-up syscall; a parked one takes microseconds to wake. The default parks at once.
+struct IdleStrategy {
+    uint32_t spins = 0;
+    uint32_t yields = 0;
+
+    static constexpr IdleStrategy park() { return {}; }
+    // a short spin, enough to catch bursts without burning a core between them
+    static constexpr IdleStrategy balanced() { return {256, 8}; }
+    // keeps idle workers on their cores for tens of microseconds, for latency-critical deployments
+    static constexpr IdleStrategy low_latency() { return {16384, 256}; }
+
+    // re-checks ready() spinning, then yielding; true as soon as it holds, false once the budget is spent
+    template <class Ready>
+    bool spin_until(Ready &&ready) const {
+        for (uint32_t i = 0; i < spins; ++i) {
+            if (ready()) {
+                return true;
+            }
+            cpu_relax();
+        }
+        for (uint32_t i = 0; i < yields; ++i) {
+            if (ready()) {
+                return true;
+            }
+            std::this_thread::yield();
+        }
+        return false;
+    }
+};
+
+}  // namespace dispatcher::queue
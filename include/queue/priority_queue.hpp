@@ -1,37 +1,155 @@
 #pragma once
 #include "queue/bounded_queue.hpp"
+#include "queue/deadline_queue.hpp"
+#include "queue/event_count.hpp"
+#include "queue/idle_strategy.hpp"
+#include "queue/ring_buffer_queue.hpp"
+#include "queue/segmented_queue.hpp"
+#include "queue/serial_task.hpp"
+#include "queue/spilling_queue.hpp"
+#include "queue/token_bucket.hpp"
 #include "queue/unbounded_queue.hpp"
+#include "level_mask.hpp"
+#include "metrics.hpp"
 #include "types.hpp"
 
+#include <array>
 #include <atomic>
+#include <chrono>
 #include <limits>
-#include <map>
 #include <memory>
-#include <mutex>
 #include <optional>
+#include <span>
 #include <stdexcept>
 #include <unordered_map>
 
 namespace dispatcher::queue {
 
+enum class SchedulingPolicy {
+    Strict,              // the highest non-empty lane always goes first
+    WeightedRoundRobin,  // non-empty lanes share pops in proportion to QueueOptions::weight, highest first in a round
+};
+
+struct SchedulingOptions {
+    SchedulingPolicy policy = SchedulingPolicy::Strict;
+    // a lane with work that has not been served for this long gets the next pop, whatever the policy
+    std::optional<std::chrono::nanoseconds> aging_threshold = std::nullopt;
+    // how consumers that find every lane empty wait, in pop() here and in the thread pool's workers
+    IdleStrategy idle{};
+};
+
 class PriorityQueue {
 public:
-    explicit PriorityQueue(const std::unordered_map<TaskPriority, QueueOptions> &config);
+    explicit PriorityQueue(const std::unordered_map<TaskPriority, QueueOptions> &config,
+                           SchedulingOptions scheduling = {});
 
-    void push(TaskPriority priority, std::function<void()> task);
+    // a full bounded lane applies its OverflowPolicy; Block waits for room
+    void push(TaskPriority priority, Task task);
+    // never waits: a full Block lane turns the task away like Reject; moves from task only on success
+    bool try_push(TaskPriority priority, Task &task);
+    // like push, but a full Block lane is waited on until deadline at most; moves from task only on success
+    bool push_until(TaskPriority priority, Task &task, std::chrono::steady_clock::time_point deadline);
+    // Like push for a task built from the type's handler and payload, except that a lane with
+    // QueueOptions::spill may keep it on disk until it is due. The type must be registered.
+    void push_serialized(TaskPriority priority, SerializedTask task);
+    // Pushes into a QueueType::Deadline lane, which runs the task before those with later deadlines
+    // and discards it, counted as expired, if it is still queued at deadline.
+    void push_deadline(TaskPriority priority, Task task, std::chrono::steady_clock::time_point deadline);
+    // pushes every task, applying the overflow policy like push
+    void push_bulk(TaskPriority priority, std::span<Task> tasks);
+    // pushes the longest prefix that is accepted without blocking and returns its length
+    size_t try_push_bulk(TaskPriority priority, std::span<Task> tasks);
     // block on pop until shutdown is called
     // after that return std::nullopt on empty queue
-    std::optional<std::function<void()>> pop();
+    // any number of threads may pop concurrently
+    std::optional<Task> pop();
+    // like pop, but also returns std::nullopt once deadline has passed
+    std::optional<Task> pop_until(std::chrono::steady_clock::time_point deadline);
+    // non-blocking pop of the task pop() would return
+    std::optional<Task> try_pop();
+    // non-blocking pop from a single lane
+    std::optional<Task> try_pop(TaskPriority priority);
+    // true when tasks leave strictly by priority, so popping lane by lane matches pop()
+    bool strict() const;
+    const IdleStrategy &idle_strategy() const { return scheduling_.idle; }
+
+    bool has_lane(TaskPriority priority) const;
+    // true when the lane has a QueueOptions::rate_limit
+    bool rate_limited(TaskPriority priority) const;
+    // An empty queue of the lane's type, for a thread pool that keeps part of the lane's tasks
+    // elsewhere (per NUMA node). Null when the lane's tasks cannot wait outside it: bounded,
+    // spilling, deadline and rate-limited lanes, and levels that are not configured.
+    std::unique_ptr<IQueue> make_shard(TaskPriority priority) const;
+    // true when the lane never turns a task away: unbounded, or bounded with OverflowPolicy::Block
+    bool lossless(TaskPriority priority) const;
+    // bit i is set when level i may hold tasks that can be popped now: a rate-limited lane out of
+    // tokens is left out until its next token is due
+    LevelMask::Bits pending_levels() const;
+    // When a rate-limited lane that holds tasks gets its next token, time_point::max() if none is
+    // waiting for one. Nobody is notified at that moment, consumers that sleep wake up by themselves.
+    std::chrono::steady_clock::time_point next_refill() const;
+    // tasks queued in all lanes
+    size_t depth() const;
 
     void shutdown();
 
+    // handlers of the tasks given to push_serialized
+    SerialTaskRegistry &serial_tasks() { return serial_tasks_; }
+
+    // counters of this queue; the thread pool adds its workers and local deques to them
+    metrics::Metrics &metrics() { return metrics_; }
+    // counters of every configured lane with the current depth of its shared queue
+    metrics::Snapshot metrics_snapshot() const;
+
     ~PriorityQueue();
 
 private:
-    std::map<TaskPriority, std::unique_ptr<IQueue>> queues_;
+    struct alignas(kCacheLineSize) Lane {
+        std::unique_ptr<IQueue> queue;
+        // tasks pushed minus tasks popped; lets pop skip empty lanes without touching their locks
+        std::atomic<int64_t> pending{0};
+        // pops left in the current weighted round
+        std::atomic<int64_t> credits{0};
+        int64_t weight = 1;
+        // steady clock nanoseconds of the last pop, or of the moment the lane became non-empty; aging only
+        std::atomic<int64_t> last_served{0};
+        OverflowPolicy overflow = OverflowPolicy::Block;
+        bool bounded = false;
+        // level receiving the overflow of a Divert lane
+        size_t divert = 0;
+        // queue when the lane spills to disk
+        SpillingQueue *spill = nullptr;
+        // queue of a QueueType::Deadline lane
+        DeadlineQueue *deadline = nullptr;
+        // tokens of a lane with QueueOptions::rate_limit
+        std::optional<TokenBucket> limit;
+        // as configured, for make_shard
+        QueueOptions options{};
+    };
+
+    size_t index(TaskPriority priority) const;
+    size_t configured_index(TaskPriority priority) const;
+    void publish(size_t index, size_t count);
+    bool admit(size_t index, Task &task, std::chrono::steady_clock::time_point deadline);
+    std::optional<Task> remove(size_t index);
+    std::optional<Task> take(size_t index);
+    void reject(TaskPriority priority, size_t count);
+    std::optional<Task> try_pop_next();
+    std::optional<Task> try_pop_highest();
+    std::optional<Task> try_pop_weighted();
+    std::optional<Task> try_pop_aged();
+    bool has_pending() const;
+
+    // outlives the lanes, whose serialized tasks point at its handlers
+    SerialTaskRegistry serial_tasks_;
+    std::array<Lane, kTaskPriorityCount> lanes_;
+    LevelMask non_empty_;
+    LevelMask::Bits configured_ = 0;
+    LevelMask::Bits rate_limited_ = 0;
+    SchedulingOptions scheduling_;
     std::atomic<bool> shutdown_{false};
-    std::mutex pop_mutex_;
-    std::condition_variable task_available_;
+    EventCount task_available_;
+    metrics::Metrics metrics_;
 };
 
-}  // namespace dispatcher::queue
\ No newline at end of file
+}  // namespace dispatcher::queue
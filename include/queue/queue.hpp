@@ -1,19 +1,75 @@
 #pragma once
-#include <functional>
+#include "task.hpp"
+#include "types.hpp"
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
 #include <optional>
+#include <span>
 
 namespace dispatcher::queue {
 
+enum class QueueType {
+    Mutex,     // std::queue guarded by a single mutex
+    LockFree,  // sequenced ring buffer when bounded, linked segments with recycling when not
+    Deadline,  // earliest deadline first, expired tasks are discarded; unbounded only, see DeadlineQueue
+};
+
+// what a push into a full bounded lane does
+enum class OverflowPolicy {
+    Block,       // the producer waits for room (schedule) or for its timeout (schedule_for)
+    Reject,      // the new task is dropped
+    DropOldest,  // the oldest queued task is dropped to make room
+    Divert,      // the task goes to QueueOptions::divert_to, by default the next lower configured lane
+};
+
+// moves the overflow of an unbounded lane to disk, see SpillingQueue
+struct SpillOptions {
+    // has to exist; segment files are created here and gone when the queue is
+    std::filesystem::path directory;
+    // tasks, and bytes of tasks and payloads, kept in memory before serialized tasks spill
+    size_t max_depth = 65536;
+    size_t max_bytes = size_t{64} << 20;
+    // size of a segment file; a bigger task gets a segment of its own
+    size_t segment_bytes = size_t{64} << 20;
+};
+
+// caps how fast tasks leave a lane, see PriorityQueue
+struct RateLimit {
+    double tasks_per_second;
+    // tokens the lane may save up while idle, so a short burst after a quiet period is not slowed down
+    int burst = 1;
+};
+
 struct QueueOptions {
     bool bounded;
     std::optional<int> capacity;
+    QueueType type = QueueType::Mutex;
+    // share of pops under SchedulingPolicy::WeightedRoundRobin
+    int weight = 1;
+    OverflowPolicy overflow = OverflowPolicy::Block;
+    // lane receiving overflow under OverflowPolicy::Divert, must have a lower priority
+    std::optional<TaskPriority> divert_to = std::nullopt;
+    // unbounded QueueType::LockFree lanes: tasks per segment, and how many drained segments are
+    // kept for reuse before the rest goes back to the allocator
+    int segment_size = 256;
+    int spare_segments = 4;
+    // unbounded QueueType::Mutex lanes: spill serialized tasks past a memory budget to disk
+    std::optional<SpillOptions> spill = std::nullopt;
+    // pops beyond the rate are held back; the lane is skipped until its next token is due
+    std::optional<RateLimit> rate_limit = std::nullopt;
 };
 
 class IQueue {
 public:
     virtual ~IQueue() = default;
-    virtual void push(std::function<void()> task) = 0;
-    virtual std::optional<std::function<void()>> try_pop() = 0;
+    virtual void push(Task task) = 0;
+    virtual std::optional<Task> try_pop() = 0;
+    // enqueues the longest prefix of tasks that fits without blocking, under a single lock or reservation;
+    // returns its length, the accepted tasks are moved from
+    virtual size_t try_push_bulk(std::span<Task> tasks) = 0;
+    // waits for room until deadline; moves from task only on success
+    virtual bool push_until(Task &task, std::chrono::steady_clock::time_point deadline) = 0;
 };
 
-}  // namespace dispatcher::queue
\ No newline at end of file
+}  // namespace dispatcher::queue
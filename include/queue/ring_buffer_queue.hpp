@@ -0,0 +1,52 @@
+#pragma once
+#include "queue/queue.hpp"
+#include "types.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+namespace dispatcher::queue {
+
+// Bounded MPMC queue on a preallocated ring buffer (D. Vyukov's scheme):
+// every slot carries a sequence number, so producers and consumers only
+// contend on their own position counter. The mutex is touched only by
+// producers that have to wait for a free slot.
+class RingBufferQueue : public IQueue {
+public:
+    explicit RingBufferQueue(int capacity);
+
+    // blocks while the queue is full, returns without pushing after shutdown
+    void push(Task task) override;
+
+    std::optional<Task> try_pop() override;
+
+    size_t try_push_bulk(std::span<Task> tasks) override;
+
+    bool push_until(Task &task, std::chrono::steady_clock::time_point deadline) override;
+
+    ~RingBufferQueue() override;
+
+private:
+    struct alignas(kCacheLineSize) Slot {
+        std::atomic<size_t> sequence;
+        Task task;
+    };
+
+    // moves from task only on success
+    bool try_push(Task &task);
+    void notify_producers();
+
+    const size_t capacity_;
+    std::unique_ptr<Slot[]> slots_;
+
+    alignas(kCacheLineSize) std::atomic<size_t> enqueue_pos_{0};
+    alignas(kCacheLineSize) std::atomic<size_t> dequeue_pos_{0};
+
+    alignas(kCacheLineSize) std::atomic<size_t> waiting_producers_{0};
+    std::atomic<bool> shutdown_{false};
+    std::mutex mutex_;
+    std::condition_variable not_full_;
+};
+
+}  // namespace dispatcher::queue
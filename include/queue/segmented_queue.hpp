@@ -0,0 +1,99 @@
+#pragma once
+#include "queue/queue.hpp"
+#include "types.hpp"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace dispatcher::queue {
+
+// Unbounded MPMC queue on a linked list of fixed-size segments. Producers claim a position with a
+// single fetch_add and consumers with a CAS on their own counter, as in RingBufferQueue, so
+// neither side takes a lock; a new segment is linked in once per segment_size pushes.
+// Drained segments are retired and, once no thread can still be looking at them (tracked with a
+// three-epoch scheme), kept for reuse up to spare_segments; beyond that they go back to the
+// allocator, so a burst does not pin its peak memory.
+class SegmentedQueue : public IQueue {
+public:
+    explicit SegmentedQueue(int segment_size = 256, int spare_segments = 4);
+
+    // never blocks, the queue has no capacity limit
+    void push(Task task) override;
+
+    std::optional<Task> try_pop() override;
+
+    size_t try_push_bulk(std::span<Task> tasks) override;
+
+    bool push_until(Task &task, std::chrono::steady_clock::time_point deadline) override;
+
+    // segments allocated right now, in use or kept for reuse
+    size_t allocated_segments() const;
+
+    ~SegmentedQueue() override;
+
+private:
+    struct alignas(kCacheLineSize) Slot {
+        std::atomic<bool> full{false};
+        Task task;
+    };
+
+    struct Segment {
+        explicit Segment(size_t size) : slots(std::make_unique<Slot[]>(size)) {}
+
+        // position of slots[0]
+        size_t base = 0;
+        std::atomic<Segment *> next{nullptr};
+        std::unique_ptr<Slot[]> slots;
+        // spare and retired lists
+        Segment *link = nullptr;
+        // epoch in which it was unlinked
+        uint64_t retired_at = 0;
+    };
+
+    // Marks the calling thread as possibly holding segment pointers. A segment retired in epoch e
+    // is reused only from epoch e + 2 on, and the epoch moves on only once the one before the
+    // current has no guards left.
+    class Guard {
+    public:
+        explicit Guard(SegmentedQueue &queue);
+        ~Guard();
+
+        Guard(const Guard &) = delete;
+        Guard &operator=(const Guard &) = delete;
+
+    private:
+        SegmentedQueue &queue_;
+        size_t slot_;
+    };
+
+    void push_one(Task &task);
+    Segment *allocate(size_t base);
+    // links a segment after last unless someone else did, returns the one linked
+    Segment *extend(Segment *last);
+    void retire(Segment *segment);
+    // called with segments_mutex_ held
+    void try_advance_epoch();
+    void release(Segment *segment);
+
+    const size_t segment_size_;
+    const size_t spare_segments_;
+
+    alignas(kCacheLineSize) std::atomic<size_t> enqueue_pos_{0};
+    std::atomic<Segment *> tail_{nullptr};
+    alignas(kCacheLineSize) std::atomic<size_t> dequeue_pos_{0};
+    std::atomic<Segment *> head_{nullptr};
+
+    alignas(kCacheLineSize) std::atomic<uint64_t> epoch_{0};
+    std::array<std::atomic<size_t>, 3> guards_{};
+
+    // spare and retired segments; touched once per segment, not per task
+    mutable std::mutex segments_mutex_;
+    Segment *spare_ = nullptr;
+    size_t spare_count_ = 0;
+    Segment *retired_ = nullptr;
+    size_t allocated_ = 0;
+};
+
+}  // namespace dispatcher::queue
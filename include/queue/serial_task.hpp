@@ -0,0 +1,37 @@
+#pragma once
+#include "task.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <shared_mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace dispatcher::queue {
+
+// A task that can leave memory: the id of a registered handler and the bytes it is called with.
+struct SerializedTask {
+    uint32_t type = 0;
+    std::vector<std::byte> payload;
+};
+
+// Handlers of serialized tasks by type id. Types are registered up front, before tasks of them
+// are scheduled, and stay registered for the lifetime of the queue.
+class SerialTaskRegistry {
+public:
+    using Handler = std::function<void(std::span<const std::byte>)>;
+
+    // throws std::invalid_argument for a null handler or a type that is already registered
+    void add(uint32_t type, Handler handler);
+    bool contains(uint32_t type) const;
+    // a task calling the type's handler with payload; the type must be registered
+    Task make_task(uint32_t type, std::vector<std::byte> payload) const;
+
+private:
+    mutable std::shared_mutex mutex_;
+    // nodes never move, so tasks keep pointers to their handler
+    std::unordered_map<uint32_t, Handler> handlers_;
+};
+
+}  // namespace dispatcher::queue
@@ -0,0 +1,76 @@
+#pragma once
+#include "queue/queue.hpp"
+#include "queue/serial_task.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+namespace dispatcher::queue {
+
+// Unbounded queue that keeps at most options.max_depth tasks and options.max_bytes bytes in
+// memory. Serialized tasks arriving past that budget are appended to memory-mapped segment files
+// in options.directory and read back in order as the queue drains; a segment is unmapped and its
+// file released once read. Closures cannot leave memory: one arriving while spilled tasks are
+// pending waits in memory and is merged back in by arrival order, so the queue stays FIFO.
+// Segment files are unlinked right after creation and never outlive the queue.
+class SpillingQueue : public IQueue {
+public:
+    SpillingQueue(SpillOptions options, const SerialTaskRegistry &registry);
+
+    void push(Task task) override;
+
+    std::optional<Task> try_pop() override;
+
+    size_t try_push_bulk(std::span<Task> tasks) override;
+
+    bool push_until(Task &task, std::chrono::steady_clock::time_point deadline) override;
+
+    // keeps the task in memory while within the budget, otherwise spills it; throws
+    // std::system_error when the segment file cannot be created
+    void push_serialized(SerializedTask &task, int64_t enqueued_at);
+
+    // tasks waiting on disk
+    size_t spilled() const;
+
+    ~SpillingQueue() override;
+
+private:
+    struct Entry {
+        Task task;
+        // counted against max_bytes
+        size_t bytes;
+    };
+
+    struct Segment {
+        int fd = -1;
+        std::byte *data = nullptr;
+        size_t capacity = 0;
+        size_t write = 0;
+        size_t read = 0;
+    };
+
+    bool spilling() const { return spilled_ > 0 || !pinned_.empty(); }
+    void append(const SerializedTask &task, int64_t enqueued_at);
+    Task read_record();
+    uint64_t next_spilled_sequence() const;
+    void open_segment(size_t capacity);
+    void close_segment(Segment &segment);
+    void push_closure(Task &task);
+
+    const SpillOptions options_;
+    const SerialTaskRegistry &registry_;
+
+    mutable std::mutex mutex_;
+    // everything here is older than anything spilled
+    std::deque<Entry> memory_;
+    size_t memory_bytes_ = 0;
+    // the spilled part: records on disk and closures that came in between, by sequence number
+    std::deque<Segment> segments_;
+    size_t spilled_ = 0;
+    std::deque<std::pair<uint64_t, Task>> pinned_;
+    uint64_t next_sequence_ = 0;
+};
+
+}  // namespace dispatcher::queue
@@ -0,0 +1,44 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
+namespace dispatcher::queue {
+
+// Token bucket refilled at tasks_per_second and holding up to burst tokens, kept as the single
+// time at which the bucket will be full again (the GCRA formulation): taking a token is one CAS
+// that pushes that time one interval further, and no thread has to refill anything.
+class TokenBucket {
+public:
+    TokenBucket(double tasks_per_second, int burst)
+        : interval_(std::max<int64_t>(std::llround(1e9 / tasks_per_second), 1)),
+          tolerance_(interval_ * (burst - 1)) {}
+
+    // takes a token if one is available at now, steady clock nanoseconds
+    bool try_acquire(int64_t now) noexcept {
+        auto full_at = full_at_.load(std::memory_order_relaxed);
+        for (;;) {
+            if (full_at - tolerance_ > now) {
+                return false;
+            }
+            if (full_at_.compare_exchange_weak(full_at, std::max(full_at, now) + interval_,
+                                               std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+    }
+
+    // gives back a token that was taken but not used
+    void refund() noexcept { full_at_.fetch_sub(interval_, std::memory_order_relaxed); }
+
+    // steady clock nanoseconds at which the next token is available, at or before now if one is
+    int64_t next_token() const noexcept { return full_at_.load(std::memory_order_relaxed) - tolerance_; }
+
+private:
+    const int64_t interval_;
+    const int64_t tolerance_;
+    std::atomic<int64_t> full_at_{0};
+};
+
+}  // namespace dispatcher::queue
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "future.hpp"
+#include "task.hpp"
+#include "types.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace dispatcher {
+
+// Serial executors keyed by an integer, the machinery behind TaskDispatcher::schedule_keyed.
+//
+// A key's tasks wait in its own list and only the head of the list is handed to the executor;
+// the next one follows when it is done, so tasks of a key run one at a time and in order while
+// different keys run side by side, and no worker ever waits for a key. The next task is handed on
+// with try_schedule: when its lane is full, the worker that finished the previous one runs it
+// right away rather than waiting for room in a lane only workers drain. A key exists only while it
+// has a task queued or running. The map is split into shards by key, each under a mutex held only
+// for a list operation, never while a task runs.
+class Strands {
+public:
+    // queues task on the executor's context without waiting; moves from task only on success
+    using TrySchedule = bool (*)(void *context, TaskPriority priority, Task &task);
+
+    // without try_schedule the next task of a key is queued with executor.schedule
+    explicit Strands(detail::Executor executor, TrySchedule try_schedule = nullptr)
+        : executor_(executor), try_schedule_(try_schedule) {}
+
+    Strands(const Strands &) = delete;
+    Strands &operator=(const Strands &) = delete;
+
+    void schedule(uint64_t key, TaskPriority priority, Task task);
+
+    // keys with a task queued or running
+    size_t active() const;
+
+private:
+    struct Pending {
+        TaskPriority priority;
+        Task task;
+    };
+
+    struct alignas(kCacheLineSize) Shard {
+        mutable std::mutex mutex;
+        // the front entry of a key is the one queued in the dispatcher or running
+        std::unordered_map<uint64_t, std::list<Pending>> keys;
+    };
+
+    static constexpr size_t kShards = 64;
+
+    Shard &shard(uint64_t key);
+    void dispatch(uint64_t key, TaskPriority priority);
+    // Runs the head of the key, and the ones after it that could not be queued. Rethrows the
+    // first exception they threw once none is left to run here.
+    void run(uint64_t key);
+    // Drops the finished head and hands the next task of the key on, or forgets the key. True when
+    // the next task could not be queued without waiting and has to run on the calling thread.
+    bool finish(uint64_t key);
+
+    detail::Executor executor_;
+    TrySchedule try_schedule_;
+    std::array<Shard, kShards> shards_;
+};
+
+}  // namespace dispatcher
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#ifndef DISPATCHER_TASK_INLINE_SIZE
+#define DISPATCHER_TASK_INLINE_SIZE 64
+#endif
+
+// runtime metrics (see metrics.hpp); when off, tasks carry no enqueue timestamp
+#ifndef DISPATCHER_METRICS
+#define DISPATCHER_METRICS 1
+#endif
+
+namespace dispatcher {
+
+namespace detail {
+
+// Size-classed free lists for closures that do not fit into a task's inline buffer.
+// Every thread keeps a small cache per class and trades whole batches with a shared
+// pool, so a closure allocated by a producer and freed by a worker is recycled
+// without going back to the global allocator.
+class BlockPool {
+public:
+    static void *allocate(std::size_t size);
+    static void deallocate(void *block, std::size_t size) noexcept;
+};
+
+template <class T>
+inline constexpr bool is_std_function = false;
+
+template <class R, class... Args>
+inline constexpr bool is_std_function<std::function<R(Args...)>> = true;
+
+}  // namespace detail
+
+// Move-only type-erased void() callable. Closures up to InlineSize bytes are stored in place,
+// bigger ones come from detail::BlockPool, so scheduling a typical lambda does not touch the heap.
+// Unlike std::function it accepts move-only closures (unique_ptr, promise captures).
+template <std::size_t InlineSize>
+class BasicTask {
+    static_assert(InlineSize >= sizeof(void *), "Inline buffer must fit at least a pointer");
+
+public:
+    BasicTask() noexcept = default;
+    BasicTask(std::nullptr_t) noexcept {}
+
+    template <class F>
+        requires(!std::is_same_v<std::remove_cvref_t<F>, BasicTask> &&
+                 std::is_invocable_r_v<void, std::remove_cvref_t<F> &>)
+    BasicTask(F &&callable) {
+        using Callable = std::remove_cvref_t<F>;
+
+        if constexpr (std::is_pointer_v<Callable> || detail::is_std_function<Callable>) {
+            if (!callable) {
+                return;
+            }
+        }
+
+        if constexpr (fits_inline<Callable>) {
+            ::new (static_cast<void *>(storage_)) Callable(std::forward<F>(callable));
+            ops_ = &inline_ops<Callable>;
+        } else {
+            void *block = allocate_block<Callable>();
+            Callable *pooled;
+            try {
+                pooled = ::new (block) Callable(std::forward<F>(callable));
+            } catch (...) {
+                deallocate_block<Callable>(block);
+                throw;
+            }
+            ::new (static_cast<void *>(storage_)) Callable *(pooled);
+            ops_ = &pooled_ops<Callable>;
+        }
+    }
+
+    BasicTask(BasicTask &&other) noexcept : ops_(other.ops_) {
+#if DISPATCHER_METRICS
+        enqueued_at_ = other.enqueued_at_;
+#endif
+        if (ops_) {
+            ops_->relocate(storage_, other.storage_);
+            other.ops_ = nullptr;
+        }
+    }
+
+    BasicTask &operator=(BasicTask &&other) noexcept {
+        if (this != &other) {
+            reset();
+#if DISPATCHER_METRICS
+            enqueued_at_ = other.enqueued_at_;
+#endif
+            if (other.ops_) {
+                other.ops_->relocate(storage_, other.storage_);
+                ops_ = std::exchange(other.ops_, nullptr);
+            }
+        }
+        return *this;
+    }
+
+    BasicTask &operator=(std::nullptr_t) noexcept {
+        reset();
+        return *this;
+    }
+
+    BasicTask(const BasicTask &) = delete;
+    BasicTask &operator=(const BasicTask &) = delete;
+
+    ~BasicTask() { reset(); }
+
+    // precondition: the task is not empty
+    void operator()() { ops_->invoke(storage_); }
+
+    explicit operator bool() const noexcept { return ops_ != nullptr; }
+
+#if DISPATCHER_METRICS
+    // steady clock nanoseconds of the last enqueue, for the queue wait time metric
+    std::int64_t enqueued_at() const noexcept { return enqueued_at_; }
+    void set_enqueued_at(std::int64_t nanoseconds) noexcept { enqueued_at_ = nanoseconds; }
+#endif
+
+    void reset() noexcept {
+        if (ops_) {
+            ops_->destroy(storage_);
+            ops_ = nullptr;
+        }
+    }
+
+private:
+    struct Ops {
+        void (*invoke)(void *storage);
+        // move-constructs into dst and destroys src
+        void (*relocate)(void *dst, void *src) noexcept;
+        void (*destroy)(void *storage) noexcept;
+    };
+
+    template <class Callable>
+    static constexpr bool fits_inline = sizeof(Callable) <= InlineSize &&
+                                        alignof(Callable) <= alignof(std::max_align_t) &&
+                                        std::is_nothrow_move_constructible_v<Callable>;
+
+    template <class Callable>
+    static constexpr bool over_aligned = alignof(Callable) > __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+    template <class Callable>
+    static void *allocate_block() {
+        if constexpr (over_aligned<Callable>) {
+            return ::operator new(sizeof(Callable), std::align_val_t{alignof(Callable)});
+        } else {
+            return detail::BlockPool::allocate(sizeof(Callable));
+        }
+    }
+
+    template <class Callable>
+    static void deallocate_block(void *block) noexcept {
+        if constexpr (over_aligned<Callable>) {
+            ::operator delete(block, std::align_val_t{alignof(Callable)});
+        } else {
+            detail::BlockPool::deallocate(block, sizeof(Callable));
+        }
+    }
+
+    template <class Callable>
+    static constexpr Ops inline_ops = {
+        [](void *storage) { (*std::launder(static_cast<Callable *>(storage)))(); },
+        [](void *dst, void *src) noexcept {
+            auto *source = std::launder(static_cast<Callable *>(src));
+            ::new (dst) Callable(std::move(*source));
+            source->~Callable();
+        },
+        [](void *storage) noexcept { std::launder(static_cast<Callable *>(storage))->~Callable(); },
+    };
+
+    template <class Callable>
+    static constexpr Ops pooled_ops = {
+        [](void *storage) { (**std::launder(static_cast<Callable **>(storage)))(); },
+        [](void *dst, void *src) noexcept { ::new (dst) Callable *(*std::launder(static_cast<Callable **>(src))); },
+        [](void *storage) noexcept {
+            auto *callable = *std::launder(static_cast<Callable **>(storage));
+            callable->~Callable();
+            deallocate_block<Callable>(callable);
+        },
+    };
+
+    alignas(std::max_align_t) std::byte storage_[InlineSize];
+    const Ops *ops_ = nullptr;
+#if DISPATCHER_METRICS
+    // fits into the padding after ops_ with the default inline size
+    std::int64_t enqueued_at_ = 0;
+#endif
+};
+
+using Task = BasicTask<DISPATCHER_TASK_INLINE_SIZE>;
+
+}  // namespace dispatcher
@@ -1,28 +1,154 @@
 #pragma once
 
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <ranges>
+#include <span>
+#include <vector>
 
+#include "async_task.hpp"
+#include "future.hpp"
+#include "metrics.hpp"
 #include "queue/priority_queue.hpp"
+#include "strands.hpp"
+#include "task.hpp"
 #include "thread_pool/thread_pool.hpp"
+#include "timer/timer_service.hpp"
 #include "types.hpp"
 
 namespace dispatcher {
 
+namespace detail {
+class ParallelLoop;
+}  // namespace detail
+
 class TaskDispatcher {
 public:
     explicit TaskDispatcher(size_t thread_count,
                             std::unordered_map<TaskPriority, queue::QueueOptions> config = {
                                 {TaskPriority::High, {true, 1000}},  // Ограниченная очередь на 1000 задач
                                 {TaskPriority::Normal, {false, {}}}  // Неограниченная очередь
-                            });
+                            },
+                            thread_pool::ThreadPoolOptions pool_options = {},
+                            queue::SchedulingOptions scheduling = {});
+
+    // a full bounded lane applies its QueueOptions::overflow policy; the default Block waits for room
+    void schedule(TaskPriority priority, Task task);
+    // For a lane of QueueType::Deadline: the lane runs its tasks earliest deadline first and drops
+    // one still queued at its deadline, counted as expired in metrics(). Other lanes throw.
+    void schedule(TaskPriority priority, Task task, std::chrono::steady_clock::time_point deadline);
+    // never waits; returns false when the lane (after its overflow policy) has no room for the task
+    bool try_schedule(TaskPriority priority, Task task);
+    // like schedule, but gives up after timeout on a full Block lane and returns false
+    bool schedule_for(TaskPriority priority, std::chrono::steady_clock::duration timeout, Task task);
+
+    // enqueues the whole batch with one lock acquisition (or one reservation on a lock-free lane)
+    // per lane pass and wakes at most as many workers as there are tasks; blocks on a full bounded
+    // lane like schedule
+    void schedule_bulk(TaskPriority priority, std::span<Task> tasks);
+    // enqueues the longest prefix of the batch that fits without blocking and returns its length
+    size_t try_schedule_bulk(TaskPriority priority, std::span<Task> tasks);
+
+    template <std::ranges::input_range Range>
+        requires std::constructible_from<Task, std::ranges::range_reference_t<Range>>
+    void schedule_range(TaskPriority priority, Range &&range) {
+        std::vector<Task> tasks;
+        if constexpr (std::ranges::sized_range<Range>) {
+            tasks.reserve(std::ranges::size(range));
+        }
+        for (auto &&callable : range) {
+            tasks.emplace_back(std::forward<decltype(callable)>(callable));
+        }
+        schedule_bulk(priority, tasks);
+    }
+
+    // Serialized tasks: a handler registered under a type id, called with the payload the task was
+    // scheduled with. Unlike closures they can wait on disk: a lane with QueueOptions::spill keeps
+    // them in memory only up to its budget. Types are registered before tasks of them are scheduled.
+    void register_task_type(uint32_t type, queue::SerialTaskRegistry::Handler handler);
+    void schedule_serialized(TaskPriority priority, uint32_t type, std::vector<std::byte> payload);
+
+    // Tasks scheduled with the same key run one at a time, in the order they were scheduled; tasks of
+    // different keys run in parallel. Each task is queued at its own priority once the previous task
+    // of its key has finished, so no worker waits for a key; when the lane is full at that moment,
+    // the worker that ran the previous task runs it as well. The lane has to be lossless (see
+    // PriorityQueue::lossless): a task it turned away would stall its key.
+    void schedule_keyed(uint64_t key, TaskPriority priority, Task task);
+
+    // keyed by std::hash of key; keys that hash alike share a strand, which costs parallelism, not order
+    template <class Key>
+        requires(!std::convertible_to<Key, uint64_t>) && requires(const Key &key) { std::hash<Key>{}(key); }
+    void schedule_keyed(const Key &key, TaskPriority priority, Task task) {
+        schedule_keyed(static_cast<uint64_t>(std::hash<Key>{}(key)), priority, std::move(task));
+    }
+
+    // schedules callable and returns a future for its result; an exception thrown by callable is stored in the future
+    template <class F>
+    auto submit(TaskPriority priority, F &&callable) {
+        using Callable = std::decay_t<F>;
+        using Result = std::invoke_result_t<Callable &>;
+
+        auto [future, promise] = detail::make_future<Result>(executor(), priority);
+        schedule(priority, [promise = std::move(promise), callable = Callable(std::forward<F>(callable))]() mutable {
+            promise.set_from(callable);
+        });
+        return std::move(future);
+    }
+
+    // co_await dispatcher.schedule_on(priority) continues the coroutine on a worker, queued at that priority
+    ScheduleAwaiter schedule_on(TaskPriority priority) { return {executor(), priority}; }
+
+    // starts the coroutine on a worker at the given priority; its inner resumptions are queued at the
+    // same priority unless it hops elsewhere with schedule_on
+    template <class T>
+    Future<T> spawn(TaskPriority priority, AsyncTask<T> task) {
+        auto [future, promise] = detail::make_future<T>(executor(), priority);
+        auto &task_promise = task.handle_.promise();
+        task_promise.bind(executor(), priority);
+        auto driver = detail::drive(std::move(task), std::move(promise));
+        task_promise.set_owner(driver.handle);
+        schedule(priority, detail::Resumption(driver.handle, driver.handle));
+        return std::move(future);
+    }
+
+    // Delayed tasks wait in a timing wheel driven by a single timer thread (started on first use),
+    // which hands them to the priority lane once due; no thread sleeps on behalf of a task.
+    timer::TimerHandle schedule_after(TaskPriority priority, std::chrono::steady_clock::duration delay, Task task);
+    timer::TimerHandle schedule_at(TaskPriority priority, std::chrono::steady_clock::time_point when, Task task);
+    // runs task every period, the first time one period from now; a run that takes longer than
+    // the period may overlap the next one
+    timer::TimerHandle schedule_every(TaskPriority priority, std::chrono::steady_clock::duration period, Task task);
+
+    // Counters collected since construction: per lane enqueued/dequeued/rejected, current depth and
+    // queue wait histogram, per worker busy and idle time, and a task run time histogram. Taken
+    // without stopping anyone, so counters of different lanes and shards are not one instant.
+    // Built with DISPATCHER_METRICS=OFF only the depths are filled in.
+    metrics::Snapshot metrics() const;
 
-    void schedule(TaskPriority priority, std::function<void()> task);
     ~TaskDispatcher();
 
 private:
+    friend class TaskGraph;
+    friend class TaskGroup;
+    friend class detail::ParallelLoop;
+
+    detail::Executor executor();
+    timer::TimerService &timers();
+    void check_timer_task(TaskPriority priority, const Task &task) const;
+
     std::shared_ptr<queue::PriorityQueue> priority_queue_;
+    // declared before the pool so that it outlives the workers running its tasks
+    std::once_flag strands_started_;
+    std::unique_ptr<Strands> strands_;
     std::unique_ptr<thread_pool::ThreadPool> thread_pool_;
     size_t thread_count_;
+    std::once_flag timers_started_;
+    std::shared_ptr<timer::TimerService> timers_;
 };
 
 }  // namespace dispatcher
\ No newline at end of file
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "task.hpp"
+#include "task_dispatcher.hpp"
+#include "types.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <vector>
+
+namespace dispatcher {
+
+// A dependency graph of tasks, built once and run any number of times.
+//
+// Every node keeps an atomic count of predecessors that have not finished yet; a run schedules the
+// nodes without predecessors, and whoever brings a successor's count to zero schedules that one.
+// A released successor of the same priority runs right away on the same worker instead of going
+// through the queue. Nodes, edges and bodies are kept between runs and the tasks handed to the
+// dispatcher fit inline, so a run allocates nothing.
+class TaskGraph {
+public:
+    using Node = size_t;
+
+    TaskGraph() = default;
+
+    TaskGraph(const TaskGraph &) = delete;
+    TaskGraph &operator=(const TaskGraph &) = delete;
+
+    // the body is kept and invoked once per run
+    Node add(TaskPriority priority, Task body);
+    // after does not start before before has finished
+    void precede(Node before, Node after);
+    size_t size() const { return nodes_.size(); }
+
+    // Schedules the graph on dispatcher and blocks until every node has run. Rethrows the first
+    // exception a node threw; nodes that had not started by then are skipped. Throws
+    // std::invalid_argument on a cycle or a priority the dispatcher has no lane for. One run at a
+    // time; a run from inside a task ties up that worker until the graph is done.
+    void run(TaskDispatcher &dispatcher);
+
+private:
+    struct alignas(kCacheLineSize) NodeData {
+        Task body;
+        TaskPriority priority;
+        std::vector<Node> successors;
+        size_t predecessors = 0;
+        // predecessors still to finish in the current run
+        std::atomic<size_t> remaining{0};
+    };
+
+    void validate(TaskDispatcher &dispatcher);
+    // runs node and then, one after another, the successors it releases at its own priority
+    void execute(Node node);
+    // hands node to the dispatcher, or runs it here when its lane has no room
+    void release(Node node);
+
+    std::deque<NodeData> nodes_;
+    std::vector<Node> roots_;
+    // roots_ and the cycle check are up to date with the edges
+    bool validated_ = false;
+
+    // state of the current run
+    TaskDispatcher *dispatcher_ = nullptr;
+    std::atomic<size_t> unfinished_{0};
+    std::atomic<bool> failed_{false};
+    std::mutex mutex_;
+    std::condition_variable done_;
+    bool finished_ = false;
+    std::exception_ptr error_;
+};
+
+}  // namespace dispatcher
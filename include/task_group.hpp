@@ -0,0 +1,81 @@
+#pragma once
+
+#include "task.hpp"
+#include "task_dispatcher.hpp"
+#include "types.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+
+namespace dispatcher {
+
+enum class TaskGroupStatus {
+    Complete,   // every task scheduled into the group ran
+    Cancelled,  // cancel() was called, tasks still queued at that moment were discarded
+};
+
+// A set of tasks that can be waited for and cancelled together.
+//
+// Group tasks wait in the group's own queue. The dispatcher only gets runners, small tasks that
+// run whichever group task is next and queue themselves again while tasks are left, at most one
+// runner per worker at a time. That lets wait() run queued group tasks on the waiting thread
+// instead of sleeping, so waiting from inside a worker (nested groups) never ties up the pool, and
+// lets cancel() throw queued bodies away at once. However many tasks the group holds, it takes at
+// most one lane slot per worker; after a cancel those runners still pass through their lanes, but
+// only as no-ops.
+class TaskGroup {
+public:
+    explicit TaskGroup(TaskDispatcher &dispatcher);
+
+    TaskGroup(const TaskGroup &) = delete;
+    TaskGroup &operator=(const TaskGroup &) = delete;
+
+    // waits for the remaining tasks; an exception they threw is dropped
+    ~TaskGroup();
+
+    // Queues task in the group and schedules it at priority. Tasks may schedule further tasks into
+    // their own group. After cancel() and until the next wait() returns, new tasks are discarded.
+    void schedule(TaskPriority priority, Task task);
+
+    // Returns once every task of the group ran or was discarded, running queued ones meanwhile.
+    // Rethrows the first exception a task threw. The group can be reused afterwards.
+    TaskGroupStatus wait();
+
+    // discards the tasks that have not started yet; running ones finish, see is_cancelled. Their
+    // bodies are freed at once, the group's queued runners (at most one per worker) leave their
+    // lanes as no-ops.
+    void cancel();
+
+    // lets long-running tasks of a cancelled group stop early
+    bool is_cancelled() const;
+
+private:
+    struct State {
+        std::mutex mutex;
+        std::condition_variable changed;
+        std::deque<Task> queue;
+        // scheduled tasks that have neither finished nor been discarded
+        size_t pending = 0;
+        size_t waiters = 0;
+        // runners queued in the dispatcher or running, at most max_runners
+        size_t runners = 0;
+        size_t max_runners = 1;
+        bool cancelled = false;
+        std::exception_ptr error;
+
+        // runs the task at the head of the queue; false when the queue is empty
+        bool run_one();
+    };
+
+    // runs the next group task, then queues itself again while tasks are left
+    static void run_next(const std::shared_ptr<State> &state, TaskDispatcher &dispatcher, TaskPriority priority);
+
+    TaskDispatcher &dispatcher_;
+    std::shared_ptr<State> state_;
+};
+
+}  // namespace dispatcher
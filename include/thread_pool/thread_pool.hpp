@@ -1,22 +1,149 @@
 #pragma once
+#include "level_mask.hpp"
 #include "queue/priority_queue.hpp"
+#include "thread_pool/topology.hpp"
+#include "thread_pool/work_stealing_deque.hpp"
+#include "types.hpp"
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
 #include <thread>
 #include <vector>
 namespace dispatcher::thread_pool {
 
+struct ThreadPoolOptions {
+    // every worker owns a deque per priority: tasks submitted from a worker stay in its deque,
+    // idle workers steal from their peers
+    bool work_stealing = false;
+    // worker i is pinned to cpu_sets[i % cpu_sets.size()]; empty leaves placement to the OS
+    std::vector<CpuSet> cpu_sets = {};
+    // Workers are dealt out over the NUMA nodes round-robin and, unless cpu_sets says otherwise,
+    // pinned to their node's CPUs. Every node gets its own copy of the unbounded lanes (see
+    // PriorityQueue::make_shard) under strict scheduling: a task submitted on a node waits there,
+    // and a worker takes a level's tasks from its own node first, then from the shared lane, its
+    // peers' deques and the other nodes. Worker deques and node lanes are built by a thread pinned
+    // to their node, so their memory is placed there. With work stealing a worker steals from peers
+    // on its own node first. On one node this changes nothing but the pinning.
+    bool numa_aware = false;
+    // the layout numa_aware works with, detected when not given
+    std::optional<Topology> topology = std::nullopt;
+
+    // Elastic mode when set: num_threads workers always run, more are started up to max_threads
+    // while every worker is busy and tasks queue up, at once when grow_depth tasks are waiting,
+    // otherwise once tasks have waited for grow_after. Workers above num_threads exit after
+    // idle_timeout without work.
+    std::optional<size_t> max_threads = std::nullopt;
+    size_t grow_depth = 16;
+    std::chrono::milliseconds grow_after{5};
+    std::chrono::milliseconds idle_timeout{2000};
+    // lets num_threads and max_threads exceed std::thread::hardware_concurrency(), for tasks that mostly block
+    bool oversubscribe = false;
+};
+
 class ThreadPool {
 public:
-    explicit ThreadPool(std::shared_ptr<queue::PriorityQueue> queue, size_t num_threads);
+    explicit ThreadPool(std::shared_ptr<queue::PriorityQueue> queue, size_t num_threads,
+                        ThreadPoolOptions options = {});
+
+    // pushes into the shared queue, or into the calling worker's own deque in work-stealing mode
+    // unless the lane is rate limited
+    void submit(TaskPriority priority, Task task);
+    // see PriorityQueue::push_until; a worker's own deque always has room
+    bool submit_until(TaskPriority priority, Task &task, std::chrono::steady_clock::time_point deadline);
+    // always goes to the shared queue, where a spilling lane may keep it on disk
+    void submit_serialized(TaskPriority priority, queue::SerializedTask task);
+    // always goes to the shared queue, whose deadline lane orders and expires it
+    void submit_deadline(TaskPriority priority, Task task, std::chrono::steady_clock::time_point deadline);
+    void submit_bulk(TaskPriority priority, std::span<Task> tasks);
+    // returns how many tasks were accepted, see PriorityQueue::try_push_bulk
+    size_t try_submit_bulk(TaskPriority priority, std::span<Task> tasks);
+    // tasks of the level waiting outside the shared queue, in workers' own deques and node lanes
+    size_t local_pending(TaskPriority priority) const;
+    // workers running right now, between num_threads and max_threads in elastic mode
+    size_t worker_count() const { return live_workers_.load(); }
+
     ~ThreadPool();
 
 private:
+    struct alignas(kCacheLineSize) Worker {
+        std::array<WorkStealingDeque, kTaskPriorityCount> deques;
+    };
+
+    // one NUMA node's copy of the lanes that can be split, null for the others
+    struct alignas(kCacheLineSize) Node {
+        std::array<std::unique_ptr<queue::IQueue>, kTaskPriorityCount> lanes;
+    };
+
     std::shared_ptr<queue::PriorityQueue> queue_;
+    // a slot per possible worker; a retired worker's slot is reused by the next one started
     std::vector<std::jthread> workers_;
     std::atomic<bool> shutdown_{false};
 
-    void worker_function();
+    ThreadPoolOptions options_;
+    // work-stealing mode only, a Worker per slot
+    std::vector<std::unique_ptr<Worker>> local_;
+    // numa_aware on more than one node only
+    std::vector<std::unique_ptr<Node>> nodes_;
+    size_t num_threads_;
+    size_t max_threads_;
+    bool elastic_;
+
+    // elastic mode only: guards workers_ and active_, the monitor thread decides when to grow
+    std::mutex workers_mutex_;
+    std::vector<bool> active_;
+    std::atomic<size_t> live_workers_{0};
+    std::atomic<size_t> busy_workers_{0};
+    std::atomic<bool> grow_requested_{false};
+    std::condition_variable monitor_cv_;
+    std::jthread monitor_;
+    // CPUs every worker is pinned to, empty for no pinning
+    std::vector<CpuSet> placement_;
+    // numa_aware only: CPUs of every node, the node of every worker slot and of every CPU
+    std::vector<CpuSet> node_cpus_;
+    std::vector<size_t> worker_node_;
+    std::vector<size_t> cpu_node_;
+    // peers every worker steals from, in order: same node first
+    std::vector<std::vector<size_t>> victims_;
+    // tasks sitting in all workers' deques, lets thieves skip scanning peers when there is nothing to steal
+    std::array<std::atomic<size_t>, kTaskPriorityCount> local_pending_{};
+    // levels with a non-zero local_pending_
+    LevelMask local_levels_;
+    // the same for the tasks in all node lanes
+    std::array<std::atomic<size_t>, kTaskPriorityCount> node_pending_{};
+    LevelMask node_levels_;
+    // workers look for work themselves instead of popping the shared queue: work stealing or node lanes
+    bool scanning_ = false;
+
+    // idle scanning workers park here; submits skip the wake-up while nobody is parked
+    queue::EventCount work_available_;
+
+    void worker_function(size_t index);
+    void scanning_worker_function(size_t index);
+    void start_worker(size_t index);
+    void retire(size_t index);
+    void monitor_function();
+    void request_growth();
+    size_t queued_tasks() const;
+    void place_workers();
+    void build_local_state();
+    size_t current_node() const;
+    void pin(size_t index) const;
+    std::optional<Task> find_task(size_t index);
+    bool has_work() const;
+    // spins and parks as the queue's IdleStrategy says; returns false when deadline passed without new work
+    bool wait_for_work(std::chrono::steady_clock::time_point deadline);
+    bool push_local(TaskPriority priority, std::span<Task> tasks);
+    void take_local(size_t level, const Task &task);
+    // into the submitting thread's node lane; false when the level has none
+    bool push_node(TaskPriority priority, std::span<Task> tasks);
+    std::optional<Task> pop_node(size_t node, size_t level);
+    void run(metrics::WorkerMetrics &worker, Task &task);
+    void notify_work(size_t count = 1);
 };
 
 }  // namespace dispatcher::thread_pool
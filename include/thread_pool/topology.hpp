@@ -0,0 +1,31 @@
+#pragma once
+#include <filesystem>
+#include <string_view>
+#include <vector>
+
+namespace dispatcher::thread_pool {
+
+// CPU numbers as the kernel counts them
+using CpuSet = std::vector<int>;
+
+// parses the kernel's cpulist format ("0-3,8,10-11"); throws std::invalid_argument on garbage
+CpuSet parse_cpu_list(std::string_view list);
+
+struct Topology {
+    // CPUs of every NUMA node that has any, in node order; never empty
+    std::vector<CpuSet> nodes;
+
+    // Reads node*/cpulist under root. Without NUMA information (not Linux, no sysfs, a single
+    // node) the result is one node holding every CPU the process may run on.
+    static Topology detect(const std::filesystem::path &root = "/sys/devices/system/node");
+};
+
+// Restricts the calling thread to cpus. Returns false when that is not possible (no CPU of the
+// set is available to the process, or the platform has no affinity call); the thread then keeps
+// running wherever the OS puts it.
+bool pin_current_thread(const CpuSet &cpus);
+
+// CPU the calling thread is running on right now, -1 where the platform cannot tell
+int current_cpu();
+
+}  // namespace dispatcher::thread_pool
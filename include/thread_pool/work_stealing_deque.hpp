@@ -0,0 +1,27 @@
+#pragma once
+#include "task.hpp"
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <span>
+
+namespace dispatcher::thread_pool {
+
+// Per-worker task deque. The owner pushes and pops at the back (LIFO keeps
+// freshly spawned work cache-hot), thieves take from the front. The lock is
+// almost always uncontended because only idle peers ever touch the front.
+class WorkStealingDeque {
+public:
+    void push(Task task);
+    void push_bulk(std::span<Task> tasks);
+
+    std::optional<Task> pop();
+
+    std::optional<Task> steal();
+
+private:
+    std::deque<Task> tasks_;
+    std::mutex mutex_;
+};
+
+}  // namespace dispatcher::thread_pool
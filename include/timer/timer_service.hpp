@@ -0,0 +1,68 @@
+#pragma once
+#include "future.hpp"
+#include "timer/timing_wheel.hpp"
+#include "types.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dispatcher::timer {
+
+class TimerService;
+
+// Cancels a timer created by TaskDispatcher::schedule_after / schedule_at / schedule_every.
+// Copyable; outliving the dispatcher is fine, cancel then just returns false.
+class TimerHandle {
+public:
+    TimerHandle() = default;
+
+    // true if the timer had not fired yet (or is periodic) and will not fire any more
+    bool cancel();
+
+private:
+    friend class TimerService;
+
+    TimerHandle(std::weak_ptr<TimerService> service, TimerId id) : service_(std::move(service)), id_(id) {}
+
+    std::weak_ptr<TimerService> service_;
+    TimerId id_;
+};
+
+// Runs a TimingWheel on one thread and hands due tasks to an executor (the dispatcher's queue).
+// The thread sleeps until the next occupied slot, so idle timers cost no wakeups.
+class TimerService : public std::enable_shared_from_this<TimerService> {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit TimerService(detail::Executor executor, Clock::duration tick = std::chrono::milliseconds(1));
+
+    // tasks never run before `when`, and at most about one tick after it
+    TimerHandle add(Clock::time_point when, TaskPriority priority, Task task, Clock::duration period = {});
+    bool cancel(TimerId id);
+
+    // stops the timer thread; pending timers are dropped
+    void shutdown();
+
+    ~TimerService();
+
+private:
+    TimingWheel::Tick to_tick(Clock::time_point time, bool round_up) const;
+    void timer_function();
+
+    detail::Executor executor_;
+    const Clock::duration tick_;
+    const Clock::time_point start_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    TimingWheel wheel_;
+    // tick the timer thread sleeps until, an earlier timer has to wake it
+    TimingWheel::Tick sleep_until_ = std::numeric_limits<TimingWheel::Tick>::max();
+    bool stop_ = false;
+    std::jthread thread_;
+};
+
+}  // namespace dispatcher::timer
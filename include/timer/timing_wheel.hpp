@@ -0,0 +1,88 @@
+#pragma once
+#include "task.hpp"
+#include "types.hpp"
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace dispatcher::timer {
+
+// identifies a timer; the generation tells a live timer from a recycled slot
+struct TimerId {
+    uint32_t index = std::numeric_limits<uint32_t>::max();
+    uint32_t generation = 0;
+};
+
+// task that became due, to be handed to the dispatcher
+struct DueTask {
+    TaskPriority priority;
+    Task task;
+};
+
+// Hierarchical timing wheel over integer ticks: 4 levels of 256 slots, each slot an intrusive
+// list of timers, so insert and cancel are O(1) whatever the number of pending timers.
+// A timer sits in the level matching its distance from now and moves down one level
+// ("cascades") when the slot above comes around. Not thread-safe.
+class TimingWheel {
+public:
+    using Tick = int64_t;
+
+    // a periodic timer (period > 0) fires at deadline, deadline + period, ... until cancelled;
+    // missed periods are skipped rather than fired in a burst
+    TimerId insert(Tick deadline, TaskPriority priority, Task task, Tick period = 0);
+    // true if the timer was pending and is now removed
+    bool cancel(TimerId id);
+
+    // moves time forward to `tick`, appending every timer that became due to `due`
+    void advance(Tick tick, std::vector<DueTask> &due);
+
+    Tick now() const { return now_; }
+    size_t size() const { return size_; }
+    // earliest tick at which advance may have work to do, std::nullopt when no timer is pending
+    std::optional<Tick> next_event() const;
+
+private:
+    static constexpr uint32_t kNone = std::numeric_limits<uint32_t>::max();
+    static constexpr int kSlotBits = 8;
+    static constexpr size_t kSlots = size_t{1} << kSlotBits;
+    static constexpr size_t kLevels = 4;
+
+    struct Node {
+        Tick deadline = 0;
+        Tick period = 0;
+        // one-shot timers own their task; periodic ones share it with every scheduled run
+        Task task;
+        std::shared_ptr<Task> periodic;
+        uint32_t prev = kNone;
+        uint32_t next = kNone;
+        uint32_t generation = 0;
+        uint16_t slot = 0;
+        TaskPriority priority = TaskPriority::Normal;
+        bool linked = false;
+    };
+
+    uint32_t allocate();
+    void release(uint32_t index);
+    void link(uint32_t index);
+    void unlink(uint32_t index);
+    void cascade(size_t level);
+    void expire(Tick until, std::vector<DueTask> &due);
+
+    std::vector<Node> nodes_;
+    uint32_t free_ = kNone;
+    // list heads, indexed by level * kSlots + slot
+    std::array<uint32_t, kLevels * kSlots> slots_ = make_empty_slots();
+    Tick now_ = 0;
+    size_t size_ = 0;
+
+    static constexpr std::array<uint32_t, kLevels * kSlots> make_empty_slots() {
+        std::array<uint32_t, kLevels * kSlots> slots{};
+        slots.fill(kNone);
+        return slots;
+    }
+};
+
+}  // namespace dispatcher::timer
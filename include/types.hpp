@@ -1,9 +1,18 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 
 namespace dispatcher {
 
-enum class TaskPriority { High, Normal };
+// Lower value means higher priority. Besides the named levels, any value below kTaskPriorityCount
+// is a valid level (e.g. TaskPriority{12}) and ranks below Scavenger.
+enum class TaskPriority : std::uint8_t { Critical, High, Interactive, Normal, Low, Batch, Background, Scavenger };
 
-}  // namespace dispatcher
\ No newline at end of file
+inline constexpr std::size_t kTaskPriorityCount = 32;
+
+// used to keep concurrently modified fields on separate cache lines
+inline constexpr std::size_t kCacheLineSize = 64;
+
+}  // namespace dispatcher
@@ -10,6 +10,9 @@
 using namespace dispatcher;
 
 int main() {
+    // tasks only copy their lines into a per-thread buffer, the flusher writes them out in batches
+    Logger::Get().EnableAsync();
+
     TaskDispatcher td(std::thread::hardware_concurrency());
     std::vector<std::jthread> threads;
 
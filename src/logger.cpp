@@ -0,0 +1,265 @@
+#include "logger.hpp"
+#include "types.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace {
+
+std::atomic<uint64_t> next_writer_id{1};
+
+// writes all of iov, resuming after partial writes; gives up on errors other than EINTR
+bool write_all(int fd, iovec *iov, int count) {
+    while (count > 0) {
+        ssize_t written = ::writev(fd, iov, count);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        auto left = static_cast<size_t>(written);
+        while (count > 0 && left >= iov->iov_len) {
+            left -= iov->iov_len;
+            ++iov;
+            --count;
+        }
+        if (count > 0) {
+            iov->iov_base = static_cast<char *>(iov->iov_base) + left;
+            iov->iov_len -= left;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+// Single-producer single-consumer byte ring. Positions only grow; the producer publishes
+// whole lines by moving tail, the flusher releases space by moving head.
+struct AsyncLogWriter::Buffer {
+    explicit Buffer(size_t capacity) : data(new char[capacity]), capacity(capacity) {}
+
+    std::unique_ptr<char[]> data;
+    const size_t capacity;
+    // set when the writer is gone, so the thread-local cache can let go of the buffer
+    std::atomic<bool> closed{false};
+    alignas(dispatcher::kCacheLineSize) std::atomic<uint64_t> head{0};
+    alignas(dispatcher::kCacheLineSize) std::atomic<uint64_t> tail{0};
+};
+
+AsyncLogWriter::AsyncLogWriter(AsyncLogOptions options)
+    : options_(std::move(options)), fd_(STDOUT_FILENO), id_(next_writer_id.fetch_add(1)) {
+    if (options_.buffer_size == 0) {
+        throw std::invalid_argument("Buffer size must be positive");
+    }
+    if (options_.flush_interval.count() <= 0) {
+        throw std::invalid_argument("Flush interval must be positive");
+    }
+    if (options_.path) {
+        fd_ = ::open(options_.path->c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd_ < 0) {
+            throw std::system_error(errno, std::generic_category(), "Cannot open log file " + *options_.path);
+        }
+        owns_fd_ = true;
+    }
+    flusher_ = std::jthread(&AsyncLogWriter::FlusherFunction, this);
+}
+
+AsyncLogWriter::~AsyncLogWriter() {
+    {
+        std::lock_guard<std::mutex> lock(flusher_mutex_);
+        stop_ = true;
+    }
+    flusher_cv_.notify_one();
+    flusher_.join();
+
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    for (auto &buffer : buffers_) {
+        buffer->closed.store(true, std::memory_order_release);
+    }
+    if (owns_fd_) {
+        ::close(fd_);
+    }
+}
+
+AsyncLogWriter::Buffer &AsyncLogWriter::LocalBuffer() {
+    struct Entry {
+        uint64_t writer;
+        std::shared_ptr<Buffer> buffer;
+    };
+    thread_local std::vector<Entry> cache;
+
+    for (auto &entry : cache) {
+        if (entry.writer == id_) {
+            return *entry.buffer;
+        }
+    }
+    std::erase_if(cache, [](const Entry &entry) { return entry.buffer->closed.load(std::memory_order_acquire); });
+
+    auto buffer = std::make_shared<Buffer>(options_.buffer_size);
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        buffers_.push_back(buffer);
+    }
+    cache.push_back({id_, buffer});
+    return *buffer;
+}
+
+void AsyncLogWriter::Write(std::string_view message) {
+    size_t size = message.size() + 1;
+    auto &buffer = LocalBuffer();
+    if (size > buffer.capacity) {
+        WriteDirect(message);
+        return;
+    }
+
+    uint64_t tail = buffer.tail.load(std::memory_order_relaxed);
+    uint64_t head = buffer.head.load(std::memory_order_acquire);
+    while (buffer.capacity - (tail - head) < size) {
+        if (options_.overflow == LogOverflow::Drop) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        WakeFlusher();
+        buffer.head.wait(head, std::memory_order_acquire);
+        head = buffer.head.load(std::memory_order_acquire);
+    }
+
+    size_t offset = tail % buffer.capacity;
+    size_t first = std::min(message.size(), buffer.capacity - offset);
+    std::memcpy(buffer.data.get() + offset, message.data(), first);
+    std::memcpy(buffer.data.get(), message.data() + first, message.size() - first);
+    buffer.data[(tail + message.size()) % buffer.capacity] = '\n';
+    buffer.tail.store(tail + size, std::memory_order_release);
+
+    // hurry the flusher along once the ring is half full instead of on every line
+    size_t half = buffer.capacity / 2;
+    if (tail - head < half && tail + size - head >= half) {
+        WakeFlusher();
+    }
+}
+
+void AsyncLogWriter::WriteDirect(std::string_view message) {
+    // earlier lines of this thread go first
+    Flush();
+    iovec iov[2] = {{const_cast<char *>(message.data()), message.size()}, {const_cast<char *>("\n"), 1}};
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    if (!write_all(fd_, iov, 2)) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void AsyncLogWriter::WakeFlusher() {
+    {
+        std::lock_guard<std::mutex> lock(flusher_mutex_);
+        wake_ = true;
+    }
+    flusher_cv_.notify_one();
+}
+
+void AsyncLogWriter::Flush() {
+    uint64_t target;
+    {
+        std::lock_guard<std::mutex> lock(flusher_mutex_);
+        target = ++flush_requested_;
+    }
+    flusher_cv_.notify_one();
+
+    std::unique_lock<std::mutex> lock(flusher_mutex_);
+    flushed_cv_.wait(lock, [this, target]() { return flush_done_ >= target; });
+}
+
+void AsyncLogWriter::FlusherFunction() {
+    std::vector<std::shared_ptr<Buffer>> buffers;
+    for (;;) {
+        uint64_t requested;
+        bool stop;
+        {
+            std::unique_lock<std::mutex> lock(flusher_mutex_);
+            flusher_cv_.wait_for(lock, options_.flush_interval,
+                                 [this]() { return wake_ || stop_ || flush_requested_ > flush_done_; });
+            wake_ = false;
+            requested = flush_requested_;
+            stop = stop_;
+        }
+
+        buffers.clear();
+        {
+            std::lock_guard<std::mutex> lock(buffers_mutex_);
+            // a buffer nobody else references belongs to an exited thread; drop it once drained
+            std::erase_if(buffers_, [](const std::shared_ptr<Buffer> &buffer) {
+                return buffer.use_count() == 1 &&
+                       buffer->head.load(std::memory_order_relaxed) == buffer->tail.load(std::memory_order_acquire);
+            });
+            buffers = buffers_;
+        }
+        Drain(buffers);
+
+        {
+            std::lock_guard<std::mutex> lock(flusher_mutex_);
+            flush_done_ = requested;
+        }
+        flushed_cv_.notify_all();
+
+        if (stop) {
+            return;
+        }
+    }
+}
+
+void AsyncLogWriter::Drain(const std::vector<std::shared_ptr<Buffer>> &buffers) {
+    struct Pending {
+        Buffer *buffer;
+        uint64_t tail;
+    };
+    std::vector<iovec> iov;
+    std::vector<Pending> pending;
+
+    auto write_batch = [this, &iov, &pending]() {
+        if (iov.empty()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(write_mutex_);
+            write_all(fd_, iov.data(), static_cast<int>(iov.size()));
+        }
+        for (auto &[buffer, tail] : pending) {
+            buffer->head.store(tail, std::memory_order_release);
+            if (options_.overflow == LogOverflow::Block) {
+                buffer->head.notify_all();
+            }
+        }
+        iov.clear();
+        pending.clear();
+    };
+
+    for (const auto &buffer : buffers) {
+        uint64_t head = buffer->head.load(std::memory_order_relaxed);
+        uint64_t tail = buffer->tail.load(std::memory_order_acquire);
+        if (head == tail) {
+            continue;
+        }
+        if (iov.size() + 2 > IOV_MAX) {
+            write_batch();
+        }
+
+        // at most two segments: up to the end of the ring and from its start
+        size_t offset = head % buffer->capacity;
+        size_t size = tail - head;
+        size_t first = std::min(size, buffer->capacity - offset);
+        iov.push_back({buffer->data.get() + offset, first});
+        if (size > first) {
+            iov.push_back({buffer->data.get(), size - first});
+        }
+        pending.push_back({buffer.get(), tail});
+    }
+    write_batch();
+}
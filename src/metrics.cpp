@@ -0,0 +1,110 @@
+#include "metrics.hpp"
+
+namespace dispatcher::metrics {
+
+uint64_t HistogramSnapshot::lower_bound(size_t bucket) noexcept {
+    if (bucket < kSubBuckets) {
+        return bucket;
+    }
+    size_t magnitude = bucket / kSubBuckets + kSubBits - 1;
+    uint64_t sub = bucket % kSubBuckets;
+    return (kSubBuckets + sub) << (magnitude - kSubBits);
+}
+
+uint64_t HistogramSnapshot::upper_bound(size_t bucket) noexcept {
+    if (bucket < kSubBuckets) {
+        return bucket;
+    }
+    size_t magnitude = bucket / kSubBuckets + kSubBits - 1;
+    return lower_bound(bucket) + ((uint64_t{1} << (magnitude - kSubBits)) - 1);
+}
+
+uint64_t HistogramSnapshot::count() const {
+    uint64_t total = 0;
+    for (auto value : buckets) {
+        total += value;
+    }
+    return total;
+}
+
+uint64_t HistogramSnapshot::percentile(double q) const {
+    uint64_t total = count();
+    if (total == 0) {
+        return 0;
+    }
+    auto rank = static_cast<uint64_t>(std::clamp(q, 0.0, 1.0) * static_cast<double>(total));
+    rank = std::clamp<uint64_t>(rank, 1, total);
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < kBuckets; ++bucket) {
+        seen += buckets[bucket];
+        if (seen >= rank) {
+            return upper_bound(bucket);
+        }
+    }
+    return upper_bound(kBuckets - 1);
+}
+
+void HistogramSnapshot::merge(const HistogramSnapshot &other) {
+    for (size_t bucket = 0; bucket < kBuckets; ++bucket) {
+        buckets[bucket] += other.buckets[bucket];
+    }
+}
+
+void Histogram::add_to(HistogramSnapshot &snapshot) const {
+    for (size_t bucket = 0; bucket < HistogramSnapshot::kBuckets; ++bucket) {
+        snapshot.buckets[bucket] += buckets_[bucket].load(std::memory_order_relaxed);
+    }
+}
+
+size_t Metrics::shard_index() noexcept {
+    static std::atomic<size_t> next_shard{0};
+    // threads are dealt out round-robin, so up to kShards threads never share a stripe
+    thread_local size_t index = next_shard.fetch_add(1, std::memory_order_relaxed) % kShards;
+    return index;
+}
+
+void Metrics::add_lane([[maybe_unused]] size_t level) {
+#if DISPATCHER_METRICS
+    for (auto &shard : shards_) {
+        shard.lanes[level] = std::make_unique<LaneCounters>();
+    }
+#endif
+}
+
+void Metrics::add_workers(size_t count) {
+    while (workers_.size() < count) {
+        workers_.push_back(std::make_unique<WorkerMetrics>());
+    }
+}
+
+Snapshot Metrics::snapshot(LevelMask::Bits levels) const {
+    Snapshot snapshot;
+
+    for (; levels != 0; levels &= levels - 1) {
+        size_t level = LevelMask::first(levels);
+        auto &lane = snapshot.lanes.emplace_back();
+        lane.priority = static_cast<TaskPriority>(level);
+        for (const auto &shard : shards_) {
+            const auto *counters = shard.lanes[level].get();
+            if (!counters) {
+                continue;
+            }
+            lane.enqueued += counters->enqueued.load();
+            lane.dequeued += counters->dequeued.load();
+            lane.rejected += counters->rejected.load();
+            lane.dropped += counters->dropped.load();
+            lane.diverted += counters->diverted.load();
+            lane.expired += counters->expired.load();
+            counters->wait_time.add_to(lane.wait_time);
+        }
+    }
+
+    for (const auto &worker : workers_) {
+        snapshot.workers.push_back({std::chrono::nanoseconds(worker->busy_.load()),
+                                    std::chrono::nanoseconds(worker->idle_.load()), worker->tasks_.load()});
+        worker->run_time_.add_to(snapshot.run_time);
+    }
+    return snapshot;
+}
+
+}  // namespace dispatcher::metrics
@@ -0,0 +1,116 @@
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+namespace dispatcher::detail {
+
+namespace {
+
+// shared with the helper tasks, which may start only after the loop has returned
+struct LoopState {
+    std::atomic<size_t> next;
+    size_t last;
+    size_t grain;
+    size_t participants;
+    ChunkBody body;
+    // indices run or skipped, the loop is over when it reaches total
+    std::atomic<size_t> finished{0};
+    size_t total;
+    std::mutex mutex;
+    std::exception_ptr error;
+
+    void finish(size_t count) {
+        if (finished.fetch_add(count, std::memory_order_acq_rel) + count == total) {
+            finished.notify_all();
+        }
+    }
+
+    void work(size_t participant) {
+        for (;;) {
+            size_t begin = next.load(std::memory_order_relaxed);
+            size_t end;
+            do {
+                if (begin >= last) {
+                    return;
+                }
+                size_t remaining = last - begin;
+                end = begin + std::min(remaining, std::max(grain, remaining / (2 * participants)));
+            } while (!next.compare_exchange_weak(begin, end, std::memory_order_relaxed));
+
+            try {
+                body.run(body.context, participant, begin, end);
+            } catch (...) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                }
+                size_t unclaimed = next.exchange(last, std::memory_order_relaxed);
+                if (unclaimed < last) {
+                    finish(last - unclaimed);
+                }
+            }
+            finish(end - begin);
+        }
+    }
+};
+
+}  // namespace
+
+size_t ParallelLoop::max_participants(const TaskDispatcher &dispatcher) {
+    return dispatcher.thread_pool_->worker_count() + 1;
+}
+
+void ParallelLoop::run(TaskDispatcher &dispatcher, size_t first, size_t last, TaskPriority priority, size_t grain,
+                       size_t participants, ChunkBody body) {
+    if (first > last) {
+        throw std::invalid_argument("Range end must not precede its start");
+    }
+    if (grain == 0) {
+        throw std::invalid_argument("Grain must be positive");
+    }
+    if (!dispatcher.priority_queue_->has_lane(priority)) {
+        throw std::invalid_argument("Unknown task priority");
+    }
+
+    size_t count = last - first;
+    size_t chunks = (count + grain - 1) / grain;
+    size_t helpers = std::min(participants, chunks) - (chunks > 0 ? 1 : 0);
+    if (helpers == 0) {
+        // too small to share: no state, no tasks
+        if (count > 0) {
+            body.run(body.context, 0, first, last);
+        }
+        return;
+    }
+
+    auto state = std::make_shared<LoopState>();
+    state->next.store(first, std::memory_order_relaxed);
+    state->last = last;
+    state->grain = grain;
+    state->participants = helpers + 1;
+    state->body = body;
+    state->total = count;
+
+    for (size_t helper = 1; helper <= helpers; ++helper) {
+        // a lane with no room just leaves more work to the participants that did start
+        dispatcher.try_schedule(priority, [state, helper]() { state->work(helper); });
+    }
+    state->work(0);
+
+    size_t finished;
+    while ((finished = state->finished.load(std::memory_order_acquire)) != count) {
+        state->finished.wait(finished, std::memory_order_acquire);
+    }
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
+
+}  // namespace dispatcher::detail
@@ -1,5 +1,7 @@
 #include "queue/bounded_queue.hpp"
 
+#include <algorithm>
+
 namespace dispatcher::queue {
 
 BoundedQueue::BoundedQueue(int capacity) : capacity_(static_cast<size_t>(capacity)), shutdown_(false) {
@@ -8,7 +10,7 @@ BoundedQueue::BoundedQueue(int capacity) : capacity_(static_cast<size_t>(capacit
     }
 }
 
-void BoundedQueue::push(std::function<void()> task) {
+void BoundedQueue::push(Task task) {
     std::unique_lock<std::mutex> lock(mutex_);
 
     not_full_.wait(lock, [this]() { return queue_.size() < capacity_ || shutdown_; });
@@ -22,7 +24,21 @@ void BoundedQueue::push(std::function<void()> task) {
     not_empty_.notify_one();
 }
 
-std::optional<std::function<void()>> BoundedQueue::try_pop() {
+bool BoundedQueue::push_until(Task &task, std::chrono::steady_clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (!not_full_.wait_until(lock, deadline, [this]() { return queue_.size() < capacity_ || shutdown_; }) ||
+        shutdown_) {
+        return false;
+    }
+
+    queue_.push(std::move(task));
+    lock.unlock();
+    not_empty_.notify_one();
+    return true;
+}
+
+std::optional<Task> BoundedQueue::try_pop() {
     std::unique_lock<std::mutex> lock(mutex_);
 
     if (queue_.empty() || shutdown_) {
@@ -37,6 +53,25 @@ std::optional<std::function<void()>> BoundedQueue::try_pop() {
     return task;
 }
 
+size_t BoundedQueue::try_push_bulk(std::span<Task> tasks) {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (shutdown_) {
+        return 0;
+    }
+
+    size_t accepted = std::min(tasks.size(), capacity_ - queue_.size());
+    for (size_t i = 0; i < accepted; ++i) {
+        queue_.push(std::move(tasks[i]));
+    }
+    lock.unlock();
+    if (accepted > 0) {
+        not_empty_.notify_all();
+    }
+
+    return accepted;
+}
+
 BoundedQueue::~BoundedQueue() {
     {
         std::lock_guard<std::mutex> lock(mutex_);
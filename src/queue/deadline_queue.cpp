@@ -0,0 +1,128 @@
+#include "queue/deadline_queue.hpp"
+
+#include "metrics.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace dispatcher::queue {
+
+void DeadlineQueue::push(Task task) { push(std::move(task), kNoDeadline); }
+
+void DeadlineQueue::push(Task task, int64_t deadline) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    insert(task, deadline);
+}
+
+bool DeadlineQueue::push_until(Task &task, std::chrono::steady_clock::time_point) {
+    // never full, so there is nothing to wait for
+    std::lock_guard<std::mutex> lock(mutex_);
+    insert(task, kNoDeadline);
+    return true;
+}
+
+size_t DeadlineQueue::try_push_bulk(std::span<Task> tasks) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    heap_.reserve(heap_.size() + tasks.size());
+    for (auto &task : tasks) {
+        insert(task, kNoDeadline);
+    }
+    return tasks.size();
+}
+
+std::optional<Task> DeadlineQueue::try_pop() {
+    // destroyed after the lock is released, like every other task that leaves a queue
+    std::vector<Task> expired;
+    std::optional<Task> task;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // expired tasks have the earliest deadlines, so they are all at the top; the clock is read
+        // only when the top has a deadline at all
+        if (!heap_.empty() && heap_.front().deadline != kNoDeadline) {
+            auto now = metrics::now_ns();
+            while (!heap_.empty() && heap_.front().deadline < now) {
+                expired.push_back(extract());
+            }
+        }
+        if (!heap_.empty()) {
+            task = extract();
+        }
+    }
+    if (!expired.empty()) {
+        expired_.fetch_add(expired.size(), std::memory_order_relaxed);
+    }
+    return task;
+}
+
+size_t DeadlineQueue::take_expired() {
+    if (expired_.load(std::memory_order_relaxed) == 0) {
+        return 0;
+    }
+    return expired_.exchange(0, std::memory_order_relaxed);
+}
+
+void DeadlineQueue::insert(Task &task, int64_t deadline) {
+    uint32_t slot;
+    if (free_slots_.empty()) {
+        slot = static_cast<uint32_t>(slots_.size());
+        slots_.push_back(std::move(task));
+    } else {
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+        slots_[slot] = std::move(task);
+    }
+    heap_.push_back({deadline, next_sequence_++, slot});
+    sift_up(heap_.size() - 1);
+}
+
+Task DeadlineQueue::extract() {
+    uint32_t slot = heap_.front().slot;
+    heap_.front() = heap_.back();
+    heap_.pop_back();
+    if (!heap_.empty()) {
+        sift_down(0);
+    }
+    free_slots_.push_back(slot);
+    return std::move(slots_[slot]);
+}
+
+void DeadlineQueue::sift_up(size_t index) {
+    Key key = heap_[index];
+    while (index > 0) {
+        size_t parent = (index - 1) / kArity;
+        if (!(key < heap_[parent])) {
+            break;
+        }
+        heap_[index] = heap_[parent];
+        index = parent;
+    }
+    heap_[index] = key;
+}
+
+void DeadlineQueue::sift_down(size_t index) {
+    Key key = heap_[index];
+    size_t size = heap_.size();
+    for (;;) {
+        size_t first = index * kArity + 1;
+        if (first >= size) {
+            break;
+        }
+        size_t last = std::min(first + kArity, size);
+        size_t least = first;
+        for (size_t child = first + 1; child < last; ++child) {
+            if (heap_[child] < heap_[least]) {
+                least = child;
+            }
+        }
+        if (!(heap_[least] < key)) {
+            break;
+        }
+        heap_[index] = heap_[least];
+        index = least;
+    }
+    heap_[index] = key;
+}
+
+DeadlineQueue::~DeadlineQueue() = default;
+
+}  // namespace dispatcher::queue
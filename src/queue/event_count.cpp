@@ -0,0 +1,122 @@
+#include "queue/event_count.hpp"
+
+#include <climits>
+#include <thread>
+
+#ifdef __linux__
+#include <cerrno>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace dispatcher::queue {
+
+namespace {
+
+// std::atomic::wait has no timeout, so on Linux the epoch is slept on with the futex directly
+// (and then also woken directly: the standard library may skip the wake for waiters it does not know)
+#ifdef __linux__
+uint32_t *futex_word(std::atomic<uint32_t> &word) { return reinterpret_cast<uint32_t *>(&word); }
+
+void futex_wake(std::atomic<uint32_t> &word, int count) {
+    syscall(SYS_futex, futex_word(word), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+}
+
+// returns false once the absolute steady clock deadline has passed
+bool futex_wait(std::atomic<uint32_t> &word, uint32_t expected, const timespec *deadline) {
+    // FUTEX_WAIT_BITSET takes an absolute CLOCK_MONOTONIC time, which is what steady_clock reads
+    long result = syscall(SYS_futex, futex_word(word), FUTEX_WAIT_BITSET_PRIVATE, expected, deadline, nullptr,
+                          FUTEX_BITSET_MATCH_ANY);
+    return result == 0 || errno != ETIMEDOUT;
+}
+#endif
+
+}  // namespace
+
+EventCount::Key EventCount::prepare_wait() {
+    waiters_.fetch_add(1, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return epoch_.load(std::memory_order_acquire);
+}
+
+void EventCount::cancel_wait() { waiters_.fetch_sub(1, std::memory_order_relaxed); }
+
+void EventCount::wait(Key key) {
+    while (epoch_.load(std::memory_order_acquire) == key) {
+#ifdef __linux__
+        futex_wait(epoch_, key, nullptr);
+#else
+        epoch_.wait(key, std::memory_order_acquire);
+#endif
+    }
+    waiters_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+bool EventCount::wait_until(Key key, std::chrono::steady_clock::time_point deadline) {
+#ifdef __linux__
+    auto since_epoch = deadline.time_since_epoch();
+    auto seconds = std::chrono::duration_cast<std::chrono::seconds>(since_epoch);
+    timespec absolute{static_cast<time_t>(seconds.count()),
+                      static_cast<long>(std::chrono::nanoseconds(since_epoch - seconds).count())};
+#endif
+    bool notified = true;
+    while (epoch_.load(std::memory_order_acquire) == key) {
+#ifdef __linux__
+        if (!futex_wait(epoch_, key, &absolute)) {
+#else
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        if (std::chrono::steady_clock::now() >= deadline) {
+#endif
+            notified = epoch_.load(std::memory_order_acquire) != key;
+            break;
+        }
+    }
+    waiters_.fetch_sub(1, std::memory_order_relaxed);
+    return notified;
+}
+
+void EventCount::notify_one() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+    epoch_.fetch_add(1, std::memory_order_release);
+    wake(1);
+}
+
+void EventCount::notify(size_t count) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    uint32_t waiters = waiters_.load(std::memory_order_relaxed);
+    if (waiters == 0 || count == 0) {
+        return;
+    }
+    epoch_.fetch_add(1, std::memory_order_release);
+    wake(count >= waiters ? INT_MAX : static_cast<int>(count));
+}
+
+void EventCount::notify_all() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+    epoch_.fetch_add(1, std::memory_order_release);
+    wake(INT_MAX);
+}
+
+void EventCount::wake(int count) {
+#ifdef __linux__
+    futex_wake(epoch_, count);
+#else
+    if (count == INT_MAX) {
+        epoch_.notify_all();
+        return;
+    }
+    for (int i = 0; i < count; ++i) {
+        epoch_.notify_one();
+    }
+#endif
+}
+
+}  // namespace dispatcher::queue
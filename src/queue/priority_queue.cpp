@@ -1,9 +1,49 @@
 #include "queue/priority_queue.hpp"
 
+#include <algorithm>
+#include <cmath>
+
 namespace dispatcher::queue {
 
-PriorityQueue::PriorityQueue(const std::unordered_map<TaskPriority, QueueOptions> &config) {
+namespace {
+
+int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+}  // namespace
+
+PriorityQueue::PriorityQueue(const std::unordered_map<TaskPriority, QueueOptions> &config,
+                             SchedulingOptions scheduling)
+    : scheduling_(scheduling) {
+    if (scheduling_.aging_threshold && scheduling_.aging_threshold->count() <= 0) {
+        throw std::invalid_argument("Aging threshold must be positive");
+    }
+
     for (const auto &[priority, options] : config) {
+        auto &target = lanes_[index(priority)];
+        auto &queue = target.queue;
+        if (options.weight <= 0) {
+            throw std::invalid_argument("Weight must be positive");
+        }
+        if (options.rate_limit) {
+            if (!(options.rate_limit->tasks_per_second > 0) || !std::isfinite(options.rate_limit->tasks_per_second)) {
+                throw std::invalid_argument("Rate limit must be positive");
+            }
+            if (options.rate_limit->burst <= 0) {
+                throw std::invalid_argument("Burst must be positive");
+            }
+            target.limit.emplace(options.rate_limit->tasks_per_second, options.rate_limit->burst);
+            rate_limited_ |= LevelMask::Bits{1} << static_cast<size_t>(priority);
+        }
+        target.options = options;
+        target.weight = options.weight;
+        target.overflow = options.overflow;
+        target.bounded = options.bounded;
+        target.credits.store(options.weight);
+        configured_ |= LevelMask::Bits{1} << static_cast<size_t>(priority);
+        metrics_.add_lane(static_cast<size_t>(priority));
         if (options.bounded) {
             if (!options.capacity.has_value()) {
                 throw std::invalid_argument("Bounded queue must have capacity");
@@ -11,63 +51,467 @@ PriorityQueue::PriorityQueue(const std::unordered_map<TaskPriority, QueueOptions
             if (options.capacity.value() <= 0) {
                 throw std::invalid_argument("Capacity must be positive");
             }
-            queues_[priority] = std::make_unique<BoundedQueue>(options.capacity.value());
+            if (options.spill) {
+                throw std::invalid_argument("Spilling lane must be unbounded");
+            }
+            // expiry already sheds a deadline lane's load, a capacity would only add a second policy
+            if (options.type == QueueType::Deadline) {
+                throw std::invalid_argument("Deadline lane must be unbounded");
+            }
+            if (options.type == QueueType::LockFree) {
+                queue = std::make_unique<RingBufferQueue>(options.capacity.value());
+            } else {
+                queue = std::make_unique<BoundedQueue>(options.capacity.value());
+            }
         } else {
-            queues_[priority] = std::make_unique<UnboundedQueue>();
+            if (options.spill) {
+                if (options.type != QueueType::Mutex) {
+                    throw std::invalid_argument("Spilling lane must be a mutex lane");
+                }
+                auto spill = std::make_unique<SpillingQueue>(*options.spill, serial_tasks_);
+                target.spill = spill.get();
+                queue = std::move(spill);
+            } else if (options.type == QueueType::Deadline) {
+                auto deadline = std::make_unique<DeadlineQueue>();
+                target.deadline = deadline.get();
+                queue = std::move(deadline);
+            } else if (options.type == QueueType::LockFree) {
+                queue = std::make_unique<SegmentedQueue>(options.segment_size, options.spare_segments);
+            } else {
+                queue = std::make_unique<UnboundedQueue>();
+            }
+        }
+    }
+
+    for (const auto &[priority, options] : config) {
+        auto level = static_cast<size_t>(priority);
+        if (options.overflow != OverflowPolicy::Divert) {
+            continue;
         }
+        // diverting only downwards keeps a chain of full lanes from going round in circles
+        size_t target = lanes_.size();
+        if (options.divert_to) {
+            target = static_cast<size_t>(*options.divert_to);
+        } else if (level + 1 < lanes_.size() && (configured_ >> (level + 1)) != 0) {
+            target = level + 1 + LevelMask::first(configured_ >> (level + 1));
+        }
+        if (target >= lanes_.size() || target <= level || !lanes_[target].queue) {
+            throw std::invalid_argument("Divert lane must be a configured lane of lower priority");
+        }
+        lanes_[level].divert = target;
     }
 }
 
-void PriorityQueue::push(TaskPriority priority, std::function<void()> task) {
-    if (shutdown_.load()) {
-        return;
+size_t PriorityQueue::index(TaskPriority priority) const {
+    auto level = static_cast<size_t>(priority);
+    if (level >= lanes_.size()) {
+        throw std::invalid_argument("Unknown task priority");
     }
+    return level;
+}
 
-    auto it = queues_.find(priority);
-    if (it == queues_.end()) {
+size_t PriorityQueue::configured_index(TaskPriority priority) const {
+    auto level = index(priority);
+    if (!lanes_[level].queue) {
         throw std::invalid_argument("Unknown task priority");
     }
+    return level;
+}
 
-    it->second->push(std::move(task));
-    task_available_.notify_one();
+void PriorityQueue::publish(size_t index, size_t count) {
+    auto &lane = lanes_[index];
+    if (lane.pending.fetch_add(static_cast<int64_t>(count)) <= 0 && scheduling_.aging_threshold) {
+        // the wait of a lane that was empty starts now, not at its last pop
+        lane.last_served.store(now_ns(), std::memory_order_relaxed);
+    }
+    non_empty_.mark(index);
+    if (count == 1) {
+        task_available_.notify_one();
+    } else {
+        task_available_.notify(count);
+    }
 }
 
-std::optional<std::function<void()>> PriorityQueue::pop() {
-    std::unique_lock<std::mutex> lock(pop_mutex_);
+void PriorityQueue::reject(TaskPriority priority, size_t count) {
+    if (has_lane(priority)) {
+        metrics_.rejected(static_cast<size_t>(priority), count);
+    }
+}
 
-    while (!shutdown_.load()) {
-        auto high_queue = queues_.find(TaskPriority::High);
-        if (high_queue != queues_.end()) {
-            if (auto task = high_queue->second->try_pop()) {
-                if (task.has_value())
-                    return task;
+bool PriorityQueue::admit(size_t index, Task &task, std::chrono::steady_clock::time_point deadline) {
+    auto &lane = lanes_[index];
+    while (lane.queue->try_push_bulk(std::span<Task>(&task, 1)) == 0) {
+        switch (lane.overflow) {
+        case OverflowPolicy::Block:
+            if (deadline == std::chrono::steady_clock::time_point::max()) {
+                lane.queue->push(std::move(task));
+            } else if (deadline == std::chrono::steady_clock::time_point::min() ||
+                       !lane.queue->push_until(task, deadline)) {
+                return false;
+            }
+            metrics_.enqueued(index, 1);
+            publish(index, 1);
+            return true;
+        case OverflowPolicy::Reject:
+            return false;
+        case OverflowPolicy::DropOldest:
+            // a consumer may empty the lane first, then the retry simply succeeds
+            if (remove(index)) {
+                metrics_.dropped(index, 1);
             }
+            break;
+        case OverflowPolicy::Divert:
+            metrics_.diverted(index, 1);
+            return admit(lane.divert, task, deadline);
         }
+    }
+    metrics_.enqueued(index, 1);
+    publish(index, 1);
+    return true;
+}
 
-        auto normal_queue = queues_.find(TaskPriority::Normal);
-        if (normal_queue != queues_.end()) {
-            if (auto task = normal_queue->second->try_pop()) {
+void PriorityQueue::push(TaskPriority priority, Task task) {
+    push_until(priority, task, std::chrono::steady_clock::time_point::max());
+}
+
+bool PriorityQueue::try_push(TaskPriority priority, Task &task) {
+    return push_until(priority, task, std::chrono::steady_clock::time_point::min());
+}
+
+bool PriorityQueue::push_until(TaskPriority priority, Task &task, std::chrono::steady_clock::time_point deadline) {
+    if (shutdown_.load()) {
+        reject(priority, 1);
+        return false;
+    }
+
+    auto level = configured_index(priority);
+    metrics::Metrics::stamp(std::span<Task>(&task, 1));
+    if (!admit(level, task, deadline)) {
+        metrics_.rejected(level, 1);
+        return false;
+    }
+    return true;
+}
+
+void PriorityQueue::push_serialized(TaskPriority priority, SerializedTask task) {
+    if (shutdown_.load()) {
+        reject(priority, 1);
+        return;
+    }
+
+    auto level = configured_index(priority);
+    if (!serial_tasks_.contains(task.type)) {
+        throw std::invalid_argument("Unknown task type");
+    }
+    auto *spill = lanes_[level].spill;
+    if (!spill) {
+        push(priority, serial_tasks_.make_task(task.type, std::move(task.payload)));
+        return;
+    }
+    spill->push_serialized(task, now_ns());
+    metrics_.enqueued(level, 1);
+    publish(level, 1);
+}
+
+void PriorityQueue::push_deadline(TaskPriority priority, Task task, std::chrono::steady_clock::time_point deadline) {
+    if (shutdown_.load()) {
+        reject(priority, 1);
+        return;
+    }
+
+    auto level = configured_index(priority);
+    auto *queue = lanes_[level].deadline;
+    if (!queue) {
+        throw std::invalid_argument("Task priority has no deadline lane");
+    }
+    auto deadline_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+    metrics::Metrics::stamp(std::span<Task>(&task, 1));
+    queue->push(std::move(task), deadline_ns);
+    metrics_.enqueued(level, 1);
+    publish(level, 1);
+}
+
+void PriorityQueue::push_bulk(TaskPriority priority, std::span<Task> tasks) {
+    if (shutdown_.load()) {
+        reject(priority, tasks.size());
+        return;
+    }
+
+    auto level = configured_index(priority);
+    auto &target = lanes_[level];
+    metrics::Metrics::stamp(tasks);
+    size_t done = 0;
+    while (done < tasks.size()) {
+        size_t accepted = target.queue->try_push_bulk(tasks.subspan(done));
+        if (accepted > 0) {
+            metrics_.enqueued(level, accepted);
+            publish(level, accepted);
+            done += accepted;
+            continue;
+        }
+        // the lane is full and what is already in is visible to consumers, so the policy may block
+        if (!admit(level, tasks[done], std::chrono::steady_clock::time_point::max())) {
+            metrics_.rejected(level, 1);
+        }
+        ++done;
+    }
+}
+
+size_t PriorityQueue::try_push_bulk(TaskPriority priority, std::span<Task> tasks) {
+    if (shutdown_.load()) {
+        reject(priority, tasks.size());
+        return 0;
+    }
+
+    auto level = configured_index(priority);
+    auto &target = lanes_[level];
+    metrics::Metrics::stamp(tasks);
+    size_t accepted = target.queue->try_push_bulk(tasks);
+    if (accepted > 0) {
+        metrics_.enqueued(level, accepted);
+        publish(level, accepted);
+    }
+    // the rest did not fit, which only a shedding policy can change
+    if (target.overflow == OverflowPolicy::DropOldest || target.overflow == OverflowPolicy::Divert) {
+        while (accepted < tasks.size() && admit(level, tasks[accepted], std::chrono::steady_clock::time_point::min())) {
+            ++accepted;
+        }
+    }
+    metrics_.rejected(level, tasks.size() - accepted);
+    return accepted;
+}
+
+std::optional<Task> PriorityQueue::remove(size_t index) {
+    auto &lane = lanes_[index];
+    if (lane.pending.load(std::memory_order_acquire) <= 0) {
+        if (non_empty_.clear(index, lane.pending)) {
+            task_available_.notify_one();
+        }
+        return std::nullopt;
+    }
+    auto task = lane.queue->try_pop();
+    int64_t removed = task ? 1 : 0;
+    if (lane.deadline) {
+        if (auto expired = lane.deadline->take_expired()) {
+            metrics_.expired(index, expired);
+            removed += static_cast<int64_t>(expired);
+        }
+    }
+    if (removed > 0 && lane.pending.fetch_sub(removed) == removed && non_empty_.clear(index, lane.pending)) {
+        task_available_.notify_one();
+    }
+    return task;
+}
+
+std::optional<Task> PriorityQueue::take(size_t index) {
+    auto &lane = lanes_[index];
+    // an empty lane is left to remove, which clears its bit, without spending a token
+    bool metered = lane.limit && lane.pending.load(std::memory_order_relaxed) > 0;
+    if (metered && !lane.limit->try_acquire(now_ns())) {
+        return std::nullopt;
+    }
+    auto task = remove(index);
+    if (!task) {
+        if (metered) {
+            lane.limit->refund();
+        }
+        return task;
+    }
+    metrics_.dequeued(index, *task);
+    if (scheduling_.aging_threshold) {
+        lanes_[index].last_served.store(now_ns(), std::memory_order_relaxed);
+    }
+    return task;
+}
+
+std::optional<Task> PriorityQueue::try_pop_next() {
+    if (scheduling_.aging_threshold) {
+        if (auto task = try_pop_aged()) {
+            return task;
+        }
+    }
+    if (scheduling_.policy == SchedulingPolicy::WeightedRoundRobin) {
+        return try_pop_weighted();
+    }
+    return try_pop_highest();
+}
+
+std::optional<Task> PriorityQueue::try_pop_highest() {
+    // the lowest set bit is the highest priority level that has work
+    for (auto levels = non_empty_.load(); levels != 0; levels &= levels - 1) {
+        if (auto task = take(LevelMask::first(levels))) {
+            return task;
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<Task> PriorityQueue::try_pop_weighted() {
+    // Tasks have unit cost, so deficit round-robin reduces to weighted round-robin: every lane may
+    // take `weight` pops per round and a new round starts once all lanes with work have spent theirs.
+    // Concurrent consumers may both start a round; that only hands out a few extra credits.
+    for (int round = 0; round < 2; ++round) {
+        auto levels = non_empty_.load();
+        if (levels == 0) {
+            return std::nullopt;
+        }
+        for (; levels != 0; levels &= levels - 1) {
+            size_t level = LevelMask::first(levels);
+            auto &lane = lanes_[level];
+            auto credits = lane.credits.load(std::memory_order_relaxed);
+            while (credits > 0 && !lane.credits.compare_exchange_weak(credits, credits - 1)) {
+            }
+            if (credits <= 0) {
+                continue;
+            }
+            if (auto task = take(level)) {
                 return task;
             }
+            lane.credits.fetch_add(1, std::memory_order_relaxed);
+        }
+        for (auto &lane : lanes_) {
+            lane.credits.store(lane.weight, std::memory_order_relaxed);
         }
-        task_available_.wait(lock);
     }
+    return try_pop_highest();
+}
 
-    auto high_queue = queues_.find(TaskPriority::High);
-    if (high_queue != queues_.end()) {
-        if (auto task = high_queue->second->try_pop()) {
-            return task;
+std::optional<Task> PriorityQueue::try_pop_aged() {
+    // the lane that has waited longest past the threshold goes first
+    int64_t oldest = now_ns() - scheduling_.aging_threshold->count();
+    size_t aged = lanes_.size();
+    for (auto levels = non_empty_.load(); levels != 0; levels &= levels - 1) {
+        size_t level = LevelMask::first(levels);
+        auto served = lanes_[level].last_served.load(std::memory_order_relaxed);
+        if (served < oldest) {
+            oldest = served;
+            aged = level;
         }
     }
+    if (aged == lanes_.size()) {
+        return std::nullopt;
+    }
+    return take(aged);
+}
+
+bool PriorityQueue::has_pending() const { return pending_levels() != 0; }
 
-    auto normal_queue = queues_.find(TaskPriority::Normal);
-    if (normal_queue != queues_.end()) {
-        if (auto task = normal_queue->second->try_pop()) {
+std::optional<Task> PriorityQueue::pop() { return pop_until(std::chrono::steady_clock::time_point::max()); }
+
+std::optional<Task> PriorityQueue::pop_until(std::chrono::steady_clock::time_point deadline) {
+    for (;;) {
+        if (auto task = try_pop_next()) {
             return task;
         }
+        if (shutdown_.load()) {
+            return std::nullopt;
+        }
+        // while spinning the consumer is not registered, so pushes skip the wake-up
+        if (scheduling_.idle.spin_until([this]() { return has_pending() || shutdown_.load(); })) {
+            continue;
+        }
+
+        auto key = task_available_.prepare_wait();
+        if (has_pending() || shutdown_.load()) {
+            task_available_.cancel_wait();
+            continue;
+        }
+        // no push announces a refill, so a consumer waiting for tokens sleeps until the next one is due
+        auto wake = std::min(deadline, next_refill());
+        if (wake == std::chrono::steady_clock::time_point::max()) {
+            task_available_.wait(key);
+        } else if (!task_available_.wait_until(key, wake) && wake == deadline) {
+            return try_pop_next();
+        }
+    }
+}
+
+std::optional<Task> PriorityQueue::try_pop() { return try_pop_next(); }
+
+std::optional<Task> PriorityQueue::try_pop(TaskPriority priority) {
+    auto level = static_cast<size_t>(priority);
+    if (level >= lanes_.size() || !lanes_[level].queue) {
+        return std::nullopt;
     }
+    return take(level);
+}
 
-    return std::nullopt;
+bool PriorityQueue::strict() const {
+    return scheduling_.policy == SchedulingPolicy::Strict && !scheduling_.aging_threshold;
+}
+
+bool PriorityQueue::has_lane(TaskPriority priority) const {
+    auto level = static_cast<size_t>(priority);
+    return level < lanes_.size() && lanes_[level].queue != nullptr;
+}
+
+bool PriorityQueue::rate_limited(TaskPriority priority) const {
+    return has_lane(priority) && lanes_[static_cast<size_t>(priority)].limit.has_value();
+}
+
+std::unique_ptr<IQueue> PriorityQueue::make_shard(TaskPriority priority) const {
+    if (!has_lane(priority)) {
+        return nullptr;
+    }
+    const auto &lane = lanes_[static_cast<size_t>(priority)];
+    if (lane.bounded || lane.spill || lane.deadline || lane.limit) {
+        return nullptr;
+    }
+    if (lane.options.type == QueueType::LockFree) {
+        return std::make_unique<SegmentedQueue>(lane.options.segment_size, lane.options.spare_segments);
+    }
+    return std::make_unique<UnboundedQueue>();
+}
+
+bool PriorityQueue::lossless(TaskPriority priority) const {
+    if (!has_lane(priority)) {
+        return false;
+    }
+    const auto &lane = lanes_[static_cast<size_t>(priority)];
+    return !lane.bounded || lane.overflow == OverflowPolicy::Block;
+}
+
+LevelMask::Bits PriorityQueue::pending_levels() const {
+    auto levels = non_empty_.load();
+    // the clock is read only while a rate-limited lane holds tasks
+    if (auto limited = levels & rate_limited_) {
+        auto now = now_ns();
+        for (; limited != 0; limited &= limited - 1) {
+            size_t level = LevelMask::first(limited);
+            if (lanes_[level].limit->next_token() > now) {
+                levels &= ~(LevelMask::Bits{1} << level);
+            }
+        }
+    }
+    return levels;
+}
+
+std::chrono::steady_clock::time_point PriorityQueue::next_refill() const {
+    int64_t next = std::numeric_limits<int64_t>::max();
+    for (auto limited = non_empty_.load() & rate_limited_; limited != 0; limited &= limited - 1) {
+        next = std::min(next, lanes_[LevelMask::first(limited)].limit->next_token());
+    }
+    if (next == std::numeric_limits<int64_t>::max()) {
+        return std::chrono::steady_clock::time_point::max();
+    }
+    return std::chrono::steady_clock::time_point(std::chrono::nanoseconds(next));
+}
+
+size_t PriorityQueue::depth() const {
+    int64_t total = 0;
+    for (auto levels = configured_; levels != 0; levels &= levels - 1) {
+        total += std::max<int64_t>(lanes_[LevelMask::first(levels)].pending.load(std::memory_order_relaxed), 0);
+    }
+    return static_cast<size_t>(total);
+}
+
+metrics::Snapshot PriorityQueue::metrics_snapshot() const {
+    auto snapshot = metrics_.snapshot(configured_);
+    for (auto &lane : snapshot.lanes) {
+        // a pop may get in between a push and its publish, so the counter can dip below zero for a moment
+        lane.depth = std::max<int64_t>(lanes_[static_cast<size_t>(lane.priority)].pending.load(), 0);
+    }
+    return snapshot;
 }
 
 void PriorityQueue::shutdown() {
@@ -77,4 +521,4 @@ void PriorityQueue::shutdown() {
 
 PriorityQueue::~PriorityQueue() { shutdown(); }
 
-}  // namespace dispatcher::queue
\ No newline at end of file
+}  // namespace dispatcher::queue
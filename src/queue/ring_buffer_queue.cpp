@@ -0,0 +1,164 @@
+#include "queue/ring_buffer_queue.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+namespace dispatcher::queue {
+
+RingBufferQueue::RingBufferQueue(int capacity) : capacity_(capacity > 0 ? static_cast<size_t>(capacity) : 0) {
+    if (capacity <= 0) {
+        throw std::invalid_argument("Capacity must be positive");
+    }
+
+    slots_ = std::make_unique<Slot[]>(capacity_);
+    for (size_t i = 0; i < capacity_; ++i) {
+        slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+bool RingBufferQueue::try_push(Task &task) {
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    Slot *slot;
+    for (;;) {
+        slot = &slots_[pos % capacity_];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        auto diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos);
+        if (diff == 0) {
+            if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;  // full
+        } else {
+            pos = enqueue_pos_.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->task = std::move(task);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+void RingBufferQueue::push(Task task) {
+    if (shutdown_.load(std::memory_order_acquire)) {
+        return;
+    }
+    if (try_push(task)) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    waiting_producers_.fetch_add(1);
+    // pairs with the fence in notify_producers: either the consumer sees us waiting
+    // or we see the slot it has just released
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    not_full_.wait(lock, [this, &task]() { return shutdown_.load() || try_push(task); });
+    waiting_producers_.fetch_sub(1);
+}
+
+bool RingBufferQueue::push_until(Task &task, std::chrono::steady_clock::time_point deadline) {
+    if (shutdown_.load(std::memory_order_acquire)) {
+        return false;
+    }
+    if (try_push(task)) {
+        return true;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    waiting_producers_.fetch_add(1);
+    // same handshake with notify_producers as in push
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool pushed = false;
+    not_full_.wait_until(lock, deadline, [this, &task, &pushed]() {
+        pushed = !shutdown_.load() && try_push(task);
+        return pushed || shutdown_.load();
+    });
+    waiting_producers_.fetch_sub(1);
+    return pushed;
+}
+
+size_t RingBufferQueue::try_push_bulk(std::span<Task> tasks) {
+    if (shutdown_.load(std::memory_order_acquire) || tasks.empty()) {
+        return 0;
+    }
+
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    size_t reserved;
+    for (;;) {
+        // count the free slots in a row starting at pos; they stay free until someone claims pos
+        size_t limit = std::min(tasks.size(), capacity_);
+        reserved = 0;
+        while (reserved < limit &&
+               slots_[(pos + reserved) % capacity_].sequence.load(std::memory_order_acquire) == pos + reserved) {
+            ++reserved;
+        }
+        if (reserved == 0) {
+            auto sequence = slots_[pos % capacity_].sequence.load(std::memory_order_acquire);
+            if (static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos) < 0) {
+                return 0;  // full
+            }
+            pos = enqueue_pos_.load(std::memory_order_relaxed);
+            continue;
+        }
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + reserved, std::memory_order_relaxed)) {
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < reserved; ++i) {
+        Slot &slot = slots_[(pos + i) % capacity_];
+        slot.task = std::move(tasks[i]);
+        slot.sequence.store(pos + i + 1, std::memory_order_release);
+    }
+    return reserved;
+}
+
+std::optional<Task> RingBufferQueue::try_pop() {
+    if (shutdown_.load(std::memory_order_acquire)) {
+        return std::nullopt;
+    }
+
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    Slot *slot;
+    for (;;) {
+        slot = &slots_[pos % capacity_];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        auto diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos + 1);
+        if (diff == 0) {
+            if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return std::nullopt;  // empty
+        } else {
+            pos = dequeue_pos_.load(std::memory_order_relaxed);
+        }
+    }
+
+    std::optional<Task> task(std::move(slot->task));
+    slot->sequence.store(pos + capacity_, std::memory_order_release);
+    notify_producers();
+
+    return task;
+}
+
+void RingBufferQueue::notify_producers() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting_producers_.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+    // taking the lock guarantees the producer is either already waiting or has not checked the slot yet
+    { std::lock_guard<std::mutex> lock(mutex_); }
+    not_full_.notify_one();
+}
+
+RingBufferQueue::~RingBufferQueue() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shutdown_ = true;
+    }
+    not_full_.notify_all();
+}
+
+}  // namespace dispatcher::queue
@@ -0,0 +1,202 @@
+#include "queue/segmented_queue.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+namespace dispatcher::queue {
+
+SegmentedQueue::Guard::Guard(SegmentedQueue &queue) : queue_(queue) {
+    for (;;) {
+        uint64_t epoch = queue_.epoch_.load();
+        slot_ = epoch % queue_.guards_.size();
+        queue_.guards_[slot_].fetch_add(1);
+        // registered in an epoch that is still current, so it cannot move two steps past us
+        if (queue_.epoch_.load() == epoch) {
+            return;
+        }
+        queue_.guards_[slot_].fetch_sub(1, std::memory_order_release);
+    }
+}
+
+SegmentedQueue::Guard::~Guard() { queue_.guards_[slot_].fetch_sub(1, std::memory_order_release); }
+
+SegmentedQueue::SegmentedQueue(int segment_size, int spare_segments)
+    : segment_size_(segment_size > 0 ? static_cast<size_t>(segment_size) : 0),
+      spare_segments_(spare_segments >= 0 ? static_cast<size_t>(spare_segments) : 0) {
+    if (segment_size <= 0) {
+        throw std::invalid_argument("Segment size must be positive");
+    }
+    if (spare_segments < 0) {
+        throw std::invalid_argument("Number of spare segments cannot be negative");
+    }
+
+    Segment *first = allocate(0);
+    head_.store(first, std::memory_order_relaxed);
+    tail_.store(first, std::memory_order_relaxed);
+}
+
+void SegmentedQueue::push(Task task) { try_push_bulk(std::span<Task>(&task, 1)); }
+
+bool SegmentedQueue::push_until(Task &task, std::chrono::steady_clock::time_point) {
+    // never full, so there is nothing to wait for
+    try_push_bulk(std::span<Task>(&task, 1));
+    return true;
+}
+
+size_t SegmentedQueue::try_push_bulk(std::span<Task> tasks) {
+    if (tasks.empty()) {
+        return 0;
+    }
+
+    Guard guard(*this);
+    // read before the positions are claimed: whoever moved the tail here had already claimed a
+    // position in this segment, so ours are not below its base
+    Segment *start = tail_.load(std::memory_order_acquire);
+    Segment *segment = start;
+    size_t pos = enqueue_pos_.fetch_add(tasks.size(), std::memory_order_relaxed);
+
+    for (auto &task : tasks) {
+        while (pos >= segment->base + segment_size_) {
+            Segment *next = segment->next.load(std::memory_order_acquire);
+            segment = next ? next : extend(segment);
+        }
+        auto &slot = segment->slots[pos - segment->base];
+        slot.task = std::move(task);
+        slot.full.store(true, std::memory_order_release);
+        ++pos;
+    }
+
+    // the tail only moves forward; losing the race means somebody moved it at least as far
+    if (segment != start) {
+        tail_.compare_exchange_strong(start, segment, std::memory_order_release, std::memory_order_relaxed);
+    }
+    return tasks.size();
+}
+
+std::optional<Task> SegmentedQueue::try_pop() {
+    Guard guard(*this);
+    for (;;) {
+        size_t pos = dequeue_pos_.load(std::memory_order_acquire);
+        Segment *segment = head_.load(std::memory_order_acquire);
+        if (pos < segment->base) {
+            continue;  // the head moved on after pos was read
+        }
+
+        while (pos >= segment->base + segment_size_) {
+            Segment *next = segment->next.load(std::memory_order_acquire);
+            if (!next) {
+                return std::nullopt;  // nobody has pushed into pos yet
+            }
+            // every position of the segment has been claimed, so whoever moves the head past it retires it
+            Segment *expected = segment;
+            if (head_.compare_exchange_strong(expected, next, std::memory_order_acq_rel)) {
+                expected = segment;
+                tail_.compare_exchange_strong(expected, next, std::memory_order_release, std::memory_order_relaxed);
+                retire(segment);
+            }
+            segment = next;
+        }
+
+        auto &slot = segment->slots[pos - segment->base];
+        if (!slot.full.load(std::memory_order_acquire)) {
+            if (pos == dequeue_pos_.load(std::memory_order_relaxed)) {
+                return std::nullopt;  // empty, or the push into pos has not finished yet
+            }
+            continue;
+        }
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+            return std::move(slot.task);
+        }
+    }
+}
+
+size_t SegmentedQueue::allocated_segments() const {
+    std::lock_guard<std::mutex> lock(segments_mutex_);
+    return allocated_;
+}
+
+SegmentedQueue::Segment *SegmentedQueue::allocate(size_t base) {
+    Segment *segment;
+    {
+        std::lock_guard<std::mutex> lock(segments_mutex_);
+        try_advance_epoch();
+        if (spare_) {
+            segment = spare_;
+            spare_ = segment->link;
+            --spare_count_;
+        } else {
+            segment = new Segment(segment_size_);
+            ++allocated_;
+        }
+    }
+    segment->base = base;
+    segment->link = nullptr;
+    return segment;
+}
+
+SegmentedQueue::Segment *SegmentedQueue::extend(Segment *last) {
+    Segment *fresh = allocate(last->base + segment_size_);
+    Segment *expected = nullptr;
+    if (last->next.compare_exchange_strong(expected, fresh, std::memory_order_acq_rel, std::memory_order_acquire)) {
+        return fresh;
+    }
+    // another producer linked one first; ours was never visible to anybody
+    std::lock_guard<std::mutex> lock(segments_mutex_);
+    release(fresh);
+    return expected;
+}
+
+void SegmentedQueue::retire(Segment *segment) {
+    std::lock_guard<std::mutex> lock(segments_mutex_);
+    segment->retired_at = epoch_.load();
+    segment->link = retired_;
+    retired_ = segment;
+    try_advance_epoch();
+}
+
+void SegmentedQueue::try_advance_epoch() {
+    uint64_t epoch = epoch_.load();
+    if (guards_[(epoch + 2) % guards_.size()].load(std::memory_order_acquire) == 0) {
+        epoch_.store(++epoch);
+    }
+
+    Segment **link = &retired_;
+    while (*link) {
+        Segment *segment = *link;
+        if (segment->retired_at + 2 <= epoch) {
+            *link = segment->link;
+            release(segment);
+        } else {
+            link = &segment->link;
+        }
+    }
+}
+
+void SegmentedQueue::release(Segment *segment) {
+    if (spare_count_ >= spare_segments_) {
+        delete segment;
+        --allocated_;
+        return;
+    }
+    for (size_t i = 0; i < segment_size_; ++i) {
+        segment->slots[i].full.store(false, std::memory_order_relaxed);
+        segment->slots[i].task = nullptr;
+    }
+    segment->next.store(nullptr, std::memory_order_relaxed);
+    segment->link = spare_;
+    spare_ = segment;
+    ++spare_count_;
+}
+
+SegmentedQueue::~SegmentedQueue() {
+    auto destroy = [](Segment *segment, auto next) {
+        while (segment) {
+            delete std::exchange(segment, next(segment));
+        }
+    };
+    destroy(head_.load(), [](Segment *segment) { return segment->next.load(); });
+    destroy(spare_, [](Segment *segment) { return segment->link; });
+    destroy(retired_, [](Segment *segment) { return segment->link; });
+}
+
+}  // namespace dispatcher::queue
@@ -0,0 +1,36 @@
+#include "queue/serial_task.hpp"
+
+#include <mutex>
+#include <stdexcept>
+
+namespace dispatcher::queue {
+
+void SerialTaskRegistry::add(uint32_t type, Handler handler) {
+    if (!handler) {
+        throw std::invalid_argument("Handler cannot be null");
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    if (!handlers_.emplace(type, std::move(handler)).second) {
+        throw std::invalid_argument("Task type is already registered");
+    }
+}
+
+bool SerialTaskRegistry::contains(uint32_t type) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return handlers_.contains(type);
+}
+
+Task SerialTaskRegistry::make_task(uint32_t type, std::vector<std::byte> payload) const {
+    const Handler *handler;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        auto found = handlers_.find(type);
+        if (found == handlers_.end()) {
+            throw std::invalid_argument("Unknown task type");
+        }
+        handler = &found->second;
+    }
+    return [handler, payload = std::move(payload)]() { (*handler)(payload); };
+}
+
+}  // namespace dispatcher::queue
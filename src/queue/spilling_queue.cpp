@@ -0,0 +1,230 @@
+#include "queue/spilling_queue.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#define DISPATCHER_SPILL_SUPPORTED 1
+#else
+#define DISPATCHER_SPILL_SUPPORTED 0
+#endif
+
+namespace dispatcher::queue {
+
+namespace {
+
+// a spilled task: header, payload, padding up to kAlignment
+struct RecordHeader {
+    uint32_t type;
+    uint32_t size;
+    uint64_t sequence;
+    int64_t enqueued_at;
+};
+
+constexpr size_t kAlignment = alignof(RecordHeader);
+
+size_t record_size(size_t payload) {
+    return (sizeof(RecordHeader) + payload + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+[[noreturn]] void throw_errno(int error, const char *what) {
+    throw std::system_error(error, std::generic_category(), what);
+}
+
+}  // namespace
+
+SpillingQueue::SpillingQueue(SpillOptions options, const SerialTaskRegistry &registry)
+    : options_(std::move(options)), registry_(registry) {
+#if !DISPATCHER_SPILL_SUPPORTED
+    throw std::invalid_argument("Spilling to disk is not supported on this platform");
+#endif
+    if (options_.max_depth == 0 || options_.max_bytes == 0 || options_.segment_bytes == 0) {
+        throw std::invalid_argument("Spill limits must be positive");
+    }
+    if (!std::filesystem::is_directory(options_.directory)) {
+        throw std::invalid_argument("Spill directory must exist");
+    }
+}
+
+void SpillingQueue::push_closure(Task &task) {
+    if (spilling()) {
+        pinned_.emplace_back(next_sequence_++, std::move(task));
+    } else {
+        memory_.push_back({std::move(task), sizeof(Task)});
+        memory_bytes_ += sizeof(Task);
+    }
+}
+
+void SpillingQueue::push(Task task) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    push_closure(task);
+}
+
+bool SpillingQueue::push_until(Task &task, std::chrono::steady_clock::time_point) {
+    // never full, so there is nothing to wait for
+    std::lock_guard<std::mutex> lock(mutex_);
+    push_closure(task);
+    return true;
+}
+
+size_t SpillingQueue::try_push_bulk(std::span<Task> tasks) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &task : tasks) {
+        push_closure(task);
+    }
+    return tasks.size();
+}
+
+void SpillingQueue::push_serialized(SerializedTask &task, [[maybe_unused]] int64_t enqueued_at) {
+    size_t bytes = sizeof(Task) + task.payload.size();
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!spilling() && memory_.size() < options_.max_depth && memory_bytes_ + bytes <= options_.max_bytes) {
+        lock.unlock();
+        // built outside the lock, the payload is moved and nothing is copied
+        auto entry = registry_.make_task(task.type, std::move(task.payload));
+#if DISPATCHER_METRICS
+        entry.set_enqueued_at(enqueued_at);
+#endif
+        lock.lock();
+        // a spill may have started meanwhile, then this task has to queue behind it
+        if (spilling()) {
+            pinned_.emplace_back(next_sequence_++, std::move(entry));
+        } else {
+            memory_.push_back({std::move(entry), bytes});
+            memory_bytes_ += bytes;
+        }
+        return;
+    }
+    append(task, enqueued_at);
+}
+
+std::optional<Task> SpillingQueue::try_pop() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!memory_.empty()) {
+        auto entry = std::move(memory_.front());
+        memory_.pop_front();
+        memory_bytes_ -= entry.bytes;
+        return std::move(entry.task);
+    }
+    if (spilled_ > 0 && (pinned_.empty() || next_spilled_sequence() < pinned_.front().first)) {
+        return read_record();
+    }
+    if (!pinned_.empty()) {
+        auto task = std::move(pinned_.front().second);
+        pinned_.pop_front();
+        return task;
+    }
+    return std::nullopt;
+}
+
+size_t SpillingQueue::spilled() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return spilled_;
+}
+
+void SpillingQueue::append(const SerializedTask &task, int64_t enqueued_at) {
+    if (task.payload.size() > UINT32_MAX) {
+        throw std::invalid_argument("Payload is too large to spill");
+    }
+    size_t size = record_size(task.payload.size());
+    if (segments_.empty() || segments_.back().capacity - segments_.back().write < size) {
+        open_segment(std::max(options_.segment_bytes, size));
+    }
+
+    auto &segment = segments_.back();
+    RecordHeader header{task.type, static_cast<uint32_t>(task.payload.size()), next_sequence_++, enqueued_at};
+    std::memcpy(segment.data + segment.write, &header, sizeof(header));
+    if (!task.payload.empty()) {
+        std::memcpy(segment.data + segment.write + sizeof(header), task.payload.data(), task.payload.size());
+    }
+    segment.write += size;
+    ++spilled_;
+}
+
+uint64_t SpillingQueue::next_spilled_sequence() const {
+    // segments that were read to the end are closed right away, so the front one has the next record
+    RecordHeader header;
+    std::memcpy(&header, segments_.front().data + segments_.front().read, sizeof(header));
+    return header.sequence;
+}
+
+Task SpillingQueue::read_record() {
+    auto &segment = segments_.front();
+    RecordHeader header;
+    std::memcpy(&header, segment.data + segment.read, sizeof(header));
+    const std::byte *payload = segment.data + segment.read + sizeof(header);
+    auto task = registry_.make_task(header.type, std::vector<std::byte>(payload, payload + header.size));
+#if DISPATCHER_METRICS
+    task.set_enqueued_at(header.enqueued_at);
+#endif
+
+    segment.read += record_size(header.size);
+    --spilled_;
+    // a segment read to the end is released, the last one too once nothing is left on disk
+    if (segment.read == segment.write && (segments_.size() > 1 || spilled_ == 0)) {
+        close_segment(segment);
+        segments_.pop_front();
+    }
+    return task;
+}
+
+void SpillingQueue::open_segment(size_t capacity) {
+#if DISPATCHER_SPILL_SUPPORTED
+    auto pattern = (options_.directory / "dispatcher-spill-XXXXXX").string();
+    std::vector<char> path(pattern.begin(), pattern.end());
+    path.push_back('\0');
+    int fd = mkstemp(path.data());
+    if (fd < 0) {
+        throw_errno(errno, "Cannot create spill segment");
+    }
+    // the file lives on only through the descriptor, so nothing is left behind after a crash
+    unlink(path.data());
+
+#ifdef __linux__
+    // reserves the blocks now: running out of disk later would be a SIGBUS on a mapped page
+    if (int error = posix_fallocate(fd, 0, static_cast<off_t>(capacity)); error != 0) {
+        close(fd);
+        throw_errno(error, "Cannot reserve spill segment");
+    }
+#else
+    if (ftruncate(fd, static_cast<off_t>(capacity)) != 0) {
+        int error = errno;
+        close(fd);
+        throw_errno(error, "Cannot reserve spill segment");
+    }
+#endif
+
+    void *data = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        int error = errno;
+        close(fd);
+        throw_errno(error, "Cannot map spill segment");
+    }
+    segments_.push_back({fd, static_cast<std::byte *>(data), capacity, 0, 0});
+#else
+    static_cast<void>(capacity);
+#endif
+}
+
+void SpillingQueue::close_segment([[maybe_unused]] Segment &segment) {
+#if DISPATCHER_SPILL_SUPPORTED
+    munmap(segment.data, segment.capacity);
+    close(segment.fd);
+#endif
+}
+
+SpillingQueue::~SpillingQueue() {
+    for (auto &segment : segments_) {
+        close_segment(segment);
+    }
+}
+
+}  // namespace dispatcher::queue
@@ -1,6 +1,5 @@
 #include "queue/unbounded_queue.hpp"
 
-#include <functional>
 #include <mutex>
 #include <queue>
 #include <semaphore>
@@ -9,7 +8,7 @@ namespace dispatcher::queue {
 
 UnboundedQueue::UnboundedQueue() : shutdown_(false) {}
 
-void UnboundedQueue::push(std::function<void()> task) {
+void UnboundedQueue::push(Task task) {
     std::lock_guard<std::mutex> lock(mutex_);
 
     if (shutdown_) {
@@ -20,7 +19,20 @@ void UnboundedQueue::push(std::function<void()> task) {
     not_empty_.notify_one();
 }
 
-std::optional<std::function<void()>> UnboundedQueue::try_pop() {
+bool UnboundedQueue::push_until(Task &task, std::chrono::steady_clock::time_point) {
+    // never full, so there is nothing to wait for
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (shutdown_) {
+        return false;
+    }
+
+    queue_.push(std::move(task));
+    not_empty_.notify_one();
+    return true;
+}
+
+std::optional<Task> UnboundedQueue::try_pop() {
     std::lock_guard<std::mutex> lock(mutex_);
 
     if (queue_.empty() || shutdown_) {
@@ -32,6 +44,20 @@ std::optional<std::function<void()>> UnboundedQueue::try_pop() {
     return task;
 }
 
+size_t UnboundedQueue::try_push_bulk(std::span<Task> tasks) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (shutdown_) {
+        return 0;
+    }
+
+    for (auto &task : tasks) {
+        queue_.push(std::move(task));
+    }
+    not_empty_.notify_all();
+    return tasks.size();
+}
+
 UnboundedQueue::~UnboundedQueue() {
     {
         std::lock_guard<std::mutex> lock(mutex_);
@@ -0,0 +1,85 @@
+#include "strands.hpp"
+
+#include <exception>
+
+namespace dispatcher {
+
+Strands::Shard &Strands::shard(uint64_t key) {
+    // keys are often small consecutive ids, so they are mixed before picking a shard
+    return shards_[((key * 0x9E3779B97F4A7C15ull) >> 32) % kShards];
+}
+
+void Strands::schedule(uint64_t key, TaskPriority priority, Task task) {
+    auto &target = shard(key);
+    {
+        std::lock_guard<std::mutex> lock(target.mutex);
+        auto &pending = target.keys[key];
+        pending.push_back({priority, std::move(task)});
+        if (pending.size() > 1) {
+            return;  // the key is busy, finish() hands this one on in turn
+        }
+    }
+    dispatch(key, priority);
+}
+
+size_t Strands::active() const {
+    size_t count = 0;
+    for (const auto &shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        count += shard.keys.size();
+    }
+    return count;
+}
+
+void Strands::dispatch(uint64_t key, TaskPriority priority) {
+    executor_.schedule(executor_.context, priority, [this, key]() { run(key); });
+}
+
+void Strands::run(uint64_t key) {
+    auto &target = shard(key);
+    std::exception_ptr error;
+    do {
+        Task task;
+        {
+            std::lock_guard<std::mutex> lock(target.mutex);
+            // the head stays in the list while it runs, so that the key keeps counting as busy
+            task = std::move(target.keys.find(key)->second.front().task);
+        }
+
+        try {
+            task();
+        } catch (...) {
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    } while (finish(key));
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+bool Strands::finish(uint64_t key) {
+    auto &target = shard(key);
+    TaskPriority next;
+    {
+        std::lock_guard<std::mutex> lock(target.mutex);
+        auto found = target.keys.find(key);
+        found->second.pop_front();
+        if (found->second.empty()) {
+            target.keys.erase(found);
+            return false;
+        }
+        next = found->second.front().priority;
+    }
+    if (!try_schedule_) {
+        dispatch(key, next);
+        return false;
+    }
+    // a blocking schedule here could leave every worker waiting on a full lane that only they drain
+    Task runner = [this, key]() { run(key); };
+    return !try_schedule_(executor_.context, next, runner);
+}
+
+}  // namespace dispatcher
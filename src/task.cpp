@@ -0,0 +1,153 @@
+#include "task.hpp"
+
+#include <algorithm>
+#include <array>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace dispatcher::detail {
+
+namespace {
+
+constexpr std::array<std::size_t, 6> kSizeClasses = {128, 256, 512, 1024, 2048, 4096};
+// blocks travel between a thread cache and the shared pool in batches of this size
+constexpr std::size_t kBatchSize = 32;
+constexpr std::size_t kThreadCacheLimit = 2 * kBatchSize;
+
+struct FreeBlock {
+    FreeBlock *next;
+};
+
+struct Batch {
+    FreeBlock *head;
+    std::size_t count;
+};
+
+struct SharedClass {
+    std::mutex mutex;
+    std::vector<Batch> batches;
+};
+
+// never destroyed: thread caches may flush into it while static objects are being torn down
+std::array<SharedClass, kSizeClasses.size()> &shared_pool() {
+    static auto *pool = new std::array<SharedClass, kSizeClasses.size()>();
+    return *pool;
+}
+
+// trivially destructible, so it stays usable for blocks freed after the flusher below has run
+struct ThreadCache {
+    std::array<FreeBlock *, kSizeClasses.size()> heads{};
+    std::array<std::size_t, kSizeClasses.size()> counts{};
+};
+
+thread_local ThreadCache cache;
+
+// moves up to kBatchSize cached blocks to the shared pool
+void flush(std::size_t size_class) {
+    Batch batch{cache.heads[size_class], std::min(kBatchSize, cache.counts[size_class])};
+    FreeBlock *last = batch.head;
+    for (std::size_t i = 1; i < batch.count; ++i) {
+        last = last->next;
+    }
+    cache.heads[size_class] = last->next;
+    cache.counts[size_class] -= batch.count;
+    last->next = nullptr;
+
+    auto &shared = shared_pool()[size_class];
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    try {
+        shared.batches.push_back(batch);
+    } catch (...) {
+        while (batch.head) {
+            ::operator delete(std::exchange(batch.head, batch.head->next));
+        }
+    }
+}
+
+// hands the cached blocks of an exiting thread over to the shared pool
+struct CacheFlusher {
+    CacheFlusher() {}
+    ~CacheFlusher() {
+        for (std::size_t size_class = 0; size_class < kSizeClasses.size(); ++size_class) {
+            while (cache.counts[size_class] > 0) {
+                flush(size_class);
+            }
+        }
+    }
+};
+
+thread_local CacheFlusher flusher;
+
+// the first call on a thread constructs the flusher and registers its destructor for thread exit
+void register_flusher() { static_cast<void>(&flusher); }
+
+std::size_t size_class_of(std::size_t size) {
+    for (std::size_t i = 0; i < kSizeClasses.size(); ++i) {
+        if (size <= kSizeClasses[i]) {
+            return i;
+        }
+    }
+    return kSizeClasses.size();
+}
+
+void refill(std::size_t size_class) {
+    register_flusher();
+
+    auto &shared = shared_pool()[size_class];
+    {
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        if (!shared.batches.empty()) {
+            cache.heads[size_class] = shared.batches.back().head;
+            cache.counts[size_class] = shared.batches.back().count;
+            shared.batches.pop_back();
+            return;
+        }
+    }
+
+    for (std::size_t i = 0; i < kBatchSize; ++i) {
+        auto *block = static_cast<FreeBlock *>(::operator new(kSizeClasses[size_class]));
+        block->next = cache.heads[size_class];
+        cache.heads[size_class] = block;
+    }
+    cache.counts[size_class] = kBatchSize;
+}
+
+}  // namespace
+
+void *BlockPool::allocate(std::size_t size) {
+    std::size_t size_class = size_class_of(size);
+    if (size_class == kSizeClasses.size()) {
+        return ::operator new(size);
+    }
+
+    if (!cache.heads[size_class]) {
+        refill(size_class);
+    }
+    FreeBlock *block = cache.heads[size_class];
+    cache.heads[size_class] = block->next;
+    --cache.counts[size_class];
+    return block;
+}
+
+void BlockPool::deallocate(void *block, std::size_t size) noexcept {
+    std::size_t size_class = size_class_of(size);
+    if (size_class == kSizeClasses.size()) {
+        ::operator delete(block);
+        return;
+    }
+
+    if (cache.counts[size_class] == 0) {
+        // threads that only ever free blocks must hand them back on exit too
+        register_flusher();
+    }
+
+    auto *free_block = static_cast<FreeBlock *>(block);
+    free_block->next = cache.heads[size_class];
+    cache.heads[size_class] = free_block;
+    if (++cache.counts[size_class] > kThreadCacheLimit) {
+        flush(size_class);
+    }
+}
+
+}  // namespace dispatcher::detail
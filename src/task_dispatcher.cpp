@@ -3,27 +3,155 @@
 
 namespace dispatcher {
 
-TaskDispatcher::TaskDispatcher(size_t thread_count, std::unordered_map<TaskPriority, queue::QueueOptions> config)
+TaskDispatcher::TaskDispatcher(size_t thread_count, std::unordered_map<TaskPriority, queue::QueueOptions> config,
+                               thread_pool::ThreadPoolOptions pool_options, queue::SchedulingOptions scheduling)
     : thread_count_(thread_count) {
 
     if (thread_count == 0) {
         throw std::invalid_argument("Thread count must be positive");
     }
-    if (thread_count > std::thread::hardware_concurrency()) {
+    if (!pool_options.oversubscribe && thread_count > std::thread::hardware_concurrency()) {
         throw std::invalid_argument("Number of threads cannot be more than supported number threads");
     }
-    priority_queue_ = std::make_shared<queue::PriorityQueue>(config);
-    thread_pool_ = std::make_unique<thread_pool::ThreadPool>(priority_queue_, thread_count);
+    priority_queue_ = std::make_shared<queue::PriorityQueue>(config, scheduling);
+    thread_pool_ = std::make_unique<thread_pool::ThreadPool>(priority_queue_, thread_count, pool_options);
 }
 
-void TaskDispatcher::schedule(TaskPriority priority, std::function<void()> task) {
+void TaskDispatcher::schedule(TaskPriority priority, Task task) {
     if (!task) {
         throw std::invalid_argument("Task cannot be null");
     }
 
-    priority_queue_->push(priority, std::move(task));
+    thread_pool_->submit(priority, std::move(task));
 }
 
-TaskDispatcher::~TaskDispatcher() {}
+void TaskDispatcher::schedule(TaskPriority priority, Task task, std::chrono::steady_clock::time_point deadline) {
+    if (!task) {
+        throw std::invalid_argument("Task cannot be null");
+    }
+
+    thread_pool_->submit_deadline(priority, std::move(task), deadline);
+}
+
+bool TaskDispatcher::try_schedule(TaskPriority priority, Task task) {
+    if (!task) {
+        throw std::invalid_argument("Task cannot be null");
+    }
+
+    return thread_pool_->submit_until(priority, task, std::chrono::steady_clock::time_point::min());
+}
+
+bool TaskDispatcher::schedule_for(TaskPriority priority, std::chrono::steady_clock::duration timeout, Task task) {
+    if (!task) {
+        throw std::invalid_argument("Task cannot be null");
+    }
+
+    return thread_pool_->submit_until(priority, task, std::chrono::steady_clock::now() + timeout);
+}
+
+void TaskDispatcher::schedule_bulk(TaskPriority priority, std::span<Task> tasks) {
+    for (const auto &task : tasks) {
+        if (!task) {
+            throw std::invalid_argument("Task cannot be null");
+        }
+    }
+
+    thread_pool_->submit_bulk(priority, tasks);
+}
+
+size_t TaskDispatcher::try_schedule_bulk(TaskPriority priority, std::span<Task> tasks) {
+    for (const auto &task : tasks) {
+        if (!task) {
+            throw std::invalid_argument("Task cannot be null");
+        }
+    }
+
+    return thread_pool_->try_submit_bulk(priority, tasks);
+}
+
+void TaskDispatcher::register_task_type(uint32_t type, queue::SerialTaskRegistry::Handler handler) {
+    priority_queue_->serial_tasks().add(type, std::move(handler));
+}
+
+void TaskDispatcher::schedule_serialized(TaskPriority priority, uint32_t type, std::vector<std::byte> payload) {
+    thread_pool_->submit_serialized(priority, {type, std::move(payload)});
+}
+
+void TaskDispatcher::schedule_keyed(uint64_t key, TaskPriority priority, Task task) {
+    if (!task) {
+        throw std::invalid_argument("Task cannot be null");
+    }
+    // later tasks of the key are queued from a worker, where an error could not reach the caller
+    if (!priority_queue_->has_lane(priority)) {
+        throw std::invalid_argument("Unknown task priority");
+    }
+    if (!priority_queue_->lossless(priority)) {
+        throw std::invalid_argument("Keyed tasks need a lane that never drops tasks");
+    }
+
+    std::call_once(strands_started_, [this]() {
+        strands_ = std::make_unique<Strands>(executor(), [](void *context, TaskPriority priority, Task &task) {
+            return static_cast<TaskDispatcher *>(context)->thread_pool_->submit_until(
+                priority, task, std::chrono::steady_clock::time_point::min());
+        });
+    });
+    strands_->schedule(key, priority, std::move(task));
+}
+
+detail::Executor TaskDispatcher::executor() {
+    return {this, [](void *context, TaskPriority priority, Task task) {
+                static_cast<TaskDispatcher *>(context)->schedule(priority, std::move(task));
+            }};
+}
+
+timer::TimerService &TaskDispatcher::timers() {
+    std::call_once(timers_started_, [this]() { timers_ = std::make_shared<timer::TimerService>(executor()); });
+    return *timers_;
+}
+
+void TaskDispatcher::check_timer_task(TaskPriority priority, const Task &task) const {
+    if (!task) {
+        throw std::invalid_argument("Task cannot be null");
+    }
+    // the timer thread cannot report a bad priority back to the caller, so it is checked up front
+    if (!priority_queue_->has_lane(priority)) {
+        throw std::invalid_argument("Unknown task priority");
+    }
+}
+
+timer::TimerHandle TaskDispatcher::schedule_after(TaskPriority priority, std::chrono::steady_clock::duration delay,
+                                                  Task task) {
+    return schedule_at(priority, std::chrono::steady_clock::now() + delay, std::move(task));
+}
+
+timer::TimerHandle TaskDispatcher::schedule_at(TaskPriority priority, std::chrono::steady_clock::time_point when,
+                                               Task task) {
+    check_timer_task(priority, task);
+    return timers().add(when, priority, std::move(task));
+}
+
+timer::TimerHandle TaskDispatcher::schedule_every(TaskPriority priority, std::chrono::steady_clock::duration period,
+                                                  Task task) {
+    check_timer_task(priority, task);
+    if (period <= std::chrono::steady_clock::duration::zero()) {
+        throw std::invalid_argument("Period must be positive");
+    }
+    return timers().add(std::chrono::steady_clock::now() + period, priority, std::move(task), period);
+}
+
+metrics::Snapshot TaskDispatcher::metrics() const {
+    auto snapshot = priority_queue_->metrics_snapshot();
+    for (auto &lane : snapshot.lanes) {
+        lane.depth += static_cast<int64_t>(thread_pool_->local_pending(lane.priority));
+    }
+    return snapshot;
+}
+
+TaskDispatcher::~TaskDispatcher() {
+    // the timer thread schedules into the pool, so it stops first
+    if (timers_) {
+        timers_->shutdown();
+    }
+}
 
 }  // namespace dispatcher
\ No newline at end of file
@@ -0,0 +1,146 @@
+#include "task_graph.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+namespace dispatcher {
+
+TaskGraph::Node TaskGraph::add(TaskPriority priority, Task body) {
+    if (!body) {
+        throw std::invalid_argument("Task cannot be null");
+    }
+
+    auto &node = nodes_.emplace_back();
+    node.body = std::move(body);
+    node.priority = priority;
+    validated_ = false;
+    return nodes_.size() - 1;
+}
+
+void TaskGraph::precede(Node before, Node after) {
+    if (before >= nodes_.size() || after >= nodes_.size()) {
+        throw std::invalid_argument("Unknown graph node");
+    }
+    if (before == after) {
+        throw std::invalid_argument("Node cannot depend on itself");
+    }
+
+    nodes_[before].successors.push_back(after);
+    ++nodes_[after].predecessors;
+    validated_ = false;
+}
+
+void TaskGraph::validate(TaskDispatcher &dispatcher) {
+    for (const auto &node : nodes_) {
+        if (!dispatcher.priority_queue_->has_lane(node.priority)) {
+            throw std::invalid_argument("Unknown task priority");
+        }
+    }
+    if (validated_) {
+        return;
+    }
+
+    // Kahn's algorithm: a node left with unfinished predecessors after the sweep sits on a cycle
+    roots_.clear();
+    std::vector<size_t> remaining(nodes_.size());
+    std::vector<Node> ready;
+    for (Node node = 0; node < nodes_.size(); ++node) {
+        remaining[node] = nodes_[node].predecessors;
+        if (remaining[node] == 0) {
+            roots_.push_back(node);
+            ready.push_back(node);
+        }
+    }
+    size_t visited = 0;
+    while (!ready.empty()) {
+        Node node = ready.back();
+        ready.pop_back();
+        ++visited;
+        for (Node successor : nodes_[node].successors) {
+            if (--remaining[successor] == 0) {
+                ready.push_back(successor);
+            }
+        }
+    }
+    if (visited != nodes_.size()) {
+        throw std::invalid_argument("Task graph has a cycle");
+    }
+    validated_ = true;
+}
+
+void TaskGraph::run(TaskDispatcher &dispatcher) {
+    validate(dispatcher);
+    if (nodes_.empty()) {
+        return;
+    }
+
+    for (auto &node : nodes_) {
+        node.remaining.store(node.predecessors, std::memory_order_relaxed);
+    }
+    dispatcher_ = &dispatcher;
+    failed_.store(false, std::memory_order_relaxed);
+    finished_ = false;
+    // published to the workers by the release of the roots
+    unfinished_.store(nodes_.size(), std::memory_order_release);
+
+    for (Node root : roots_) {
+        release(root);
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this]() { return finished_; });
+    if (auto error = std::exchange(error_, nullptr)) {
+        lock.unlock();
+        std::rethrow_exception(error);
+    }
+}
+
+void TaskGraph::release(Node node) {
+    if (!dispatcher_->try_schedule(nodes_[node].priority, [this, node]() { execute(node); })) {
+        execute(node);
+    }
+}
+
+void TaskGraph::execute(Node node) {
+    for (;;) {
+        auto &data = nodes_[node];
+        if (!failed_.load(std::memory_order_relaxed)) {
+            try {
+                data.body();
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!error_) {
+                    error_ = std::current_exception();
+                }
+                failed_.store(true, std::memory_order_relaxed);
+            }
+        }
+
+        constexpr Node kNone = ~Node{0};
+        Node next = kNone;
+        for (Node successor : data.successors) {
+            if (nodes_[successor].remaining.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+                continue;
+            }
+            if (next == kNone && nodes_[successor].priority == data.priority) {
+                next = successor;
+            } else {
+                release(successor);
+            }
+        }
+
+        // once the last node is counted run() may return and the graph go away, only the handshake follows
+        if (unfinished_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            finished_ = true;
+            done_.notify_all();
+            return;
+        }
+        if (next == kNone) {
+            return;
+        }
+        node = next;
+    }
+}
+
+}  // namespace dispatcher
@@ -0,0 +1,148 @@
+#include "task_group.hpp"
+
+#include <chrono>
+#include <stdexcept>
+#include <utility>
+
+namespace dispatcher {
+
+TaskGroup::TaskGroup(TaskDispatcher &dispatcher) : dispatcher_(dispatcher), state_(std::make_shared<State>()) {
+    // more runners than workers could not run at the same time anyway, they would only hold lane slots
+    state_->max_runners = dispatcher.thread_count_;
+}
+
+TaskGroup::~TaskGroup() {
+    try {
+        wait();
+    } catch (...) {
+    }
+}
+
+bool TaskGroup::State::run_one() {
+    Task task;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (queue.empty()) {
+            return false;
+        }
+        task = std::move(queue.front());
+        queue.pop_front();
+    }
+
+    try {
+        task();
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!error) {
+            error = std::current_exception();
+        }
+    }
+    task = nullptr;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (--pending == 0 && waiters > 0) {
+        changed.notify_all();
+    }
+    return true;
+}
+
+void TaskGroup::run_next(const std::shared_ptr<State> &state, TaskDispatcher &dispatcher, TaskPriority priority) {
+    for (;;) {
+        state->run_one();
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (state->queue.empty()) {
+                --state->runners;
+                return;
+            }
+        }
+        // queued again rather than looping, so that the lane's other tasks get their turn
+        Task next = [state, &dispatcher, priority]() { run_next(state, dispatcher, priority); };
+        if (dispatcher.thread_pool_->submit_until(priority, next, std::chrono::steady_clock::time_point::min())) {
+            return;
+        }
+        // the lane is full: a worker must not wait for room, so the next task runs here
+    }
+}
+
+void TaskGroup::schedule(TaskPriority priority, Task task) {
+    if (!task) {
+        throw std::invalid_argument("Task cannot be null");
+    }
+    // checked here, a runner the dispatcher refused would leave its task to wait() alone
+    if (!dispatcher_.priority_queue_->has_lane(priority)) {
+        throw std::invalid_argument("Unknown task priority");
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        if (state_->cancelled) {
+            return;
+        }
+        state_->queue.push_back(std::move(task));
+        ++state_->pending;
+        if (state_->waiters > 0) {
+            state_->changed.notify_one();
+        }
+        // the runners already queued will get to this task as well
+        if (state_->runners == state_->max_runners) {
+            return;
+        }
+        ++state_->runners;
+    }
+    Task runner = [state = state_, &dispatcher = dispatcher_, priority]() { run_next(state, dispatcher, priority); };
+    if (!dispatcher_.thread_pool_->submit_until(priority, runner, std::chrono::steady_clock::time_point::max())) {
+        // Dropped by a full Reject lane or a shut down dispatcher. Harmless: the task is still in
+        // the group queue and the next runner or wait() runs it.
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        --state_->runners;
+    }
+}
+
+TaskGroupStatus TaskGroup::wait() {
+    for (;;) {
+        if (state_->run_one()) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(state_->mutex);
+        if (state_->pending == 0) {
+            break;
+        }
+        if (state_->queue.empty()) {
+            // the rest is running on workers; wake up for their completion or for new tasks to help with
+            ++state_->waiters;
+            state_->changed.wait(lock, [this]() { return state_->pending == 0 || !state_->queue.empty(); });
+            --state_->waiters;
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(state_->mutex);
+    auto status = state_->cancelled ? TaskGroupStatus::Cancelled : TaskGroupStatus::Complete;
+    state_->cancelled = false;
+    if (auto error = std::exchange(state_->error, nullptr)) {
+        lock.unlock();
+        std::rethrow_exception(error);
+    }
+    return status;
+}
+
+void TaskGroup::cancel() {
+    std::deque<Task> discarded;
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        state_->cancelled = true;
+        discarded.swap(state_->queue);
+        state_->pending -= discarded.size();
+        if (state_->pending == 0 && state_->waiters > 0) {
+            state_->changed.notify_all();
+        }
+    }
+    // the bodies, and whatever they captured, are destroyed outside the lock
+}
+
+bool TaskGroup::is_cancelled() const {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    return state_->cancelled;
+}
+
+}  // namespace dispatcher
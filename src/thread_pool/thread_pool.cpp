@@ -1,47 +1,541 @@
 #include "thread_pool/thread_pool.hpp"
+#include <algorithm>
+#include <exception>
 #include <iostream>
 namespace dispatcher::thread_pool {
 
-ThreadPool::ThreadPool(std::shared_ptr<queue::PriorityQueue> queue, size_t num_threads) : queue_(std::move(queue)) {
+namespace {
+
+// worker the current thread belongs to, used to route submits from inside a task into its own deque or node
+thread_local const ThreadPool *current_pool = nullptr;
+thread_local size_t current_index = 0;
+
+void run_task(Task &task) {
+    try {
+        task();
+    } catch (const std::exception &e) {
+        std::println(std::cerr, "Exception in thread pool task: {}", e.what());
+    } catch (...) {
+        std::println(std::cerr, "Unknown exception in thread pool task");
+    }
+}
+
+}  // namespace
+
+ThreadPool::ThreadPool(std::shared_ptr<queue::PriorityQueue> queue, size_t num_threads, ThreadPoolOptions options)
+    : queue_(std::move(queue)), options_(std::move(options)), num_threads_(num_threads),
+      max_threads_(options_.max_threads.value_or(num_threads)), elastic_(max_threads_ > num_threads) {
 
     if (num_threads == 0) {
         throw std::invalid_argument("Number of threads must be positive");
     }
-    if (num_threads > std::thread::hardware_concurrency()) {
+    if (max_threads_ < num_threads) {
+        throw std::invalid_argument("Maximum number of threads cannot be less than the minimum");
+    }
+    if (!options_.oversubscribe && max_threads_ > std::thread::hardware_concurrency()) {
         throw std::invalid_argument("Number of threads cannot be more than supported number threads");
     }
+    if (options_.grow_after.count() <= 0 || options_.idle_timeout.count() <= 0) {
+        throw std::invalid_argument("Growth delay and idle timeout must be positive");
+    }
 
     if (!queue_) {
         throw std::invalid_argument("PriorityQueue cannot be null");
     }
 
-    workers_.reserve(num_threads);
+    place_workers();
+    build_local_state();
+    scanning_ = options_.work_stealing || !nodes_.empty();
+    queue_->metrics().add_workers(max_threads_);
+    workers_.resize(max_threads_);
+    active_.resize(max_threads_, false);
     for (size_t i = 0; i < num_threads; ++i) {
-        workers_.emplace_back(&ThreadPool::worker_function, this);
+        start_worker(i);
+    }
+    if (elastic_) {
+        monitor_ = std::jthread(&ThreadPool::monitor_function, this);
+    }
+}
+
+void ThreadPool::start_worker(size_t index) {
+    // a retired worker has already left its loop, so replacing its thread only joins a finished thread
+    active_[index] = true;
+    live_workers_.fetch_add(1);
+    if (scanning_) {
+        workers_[index] = std::jthread(&ThreadPool::scanning_worker_function, this, index);
+    } else {
+        workers_[index] = std::jthread(&ThreadPool::worker_function, this, index);
+    }
+}
+
+void ThreadPool::retire(size_t index) {
+    std::lock_guard<std::mutex> lock(workers_mutex_);
+    active_[index] = false;
+    live_workers_.fetch_sub(1);
+}
+
+void ThreadPool::monitor_function() {
+    std::unique_lock<std::mutex> lock(workers_mutex_);
+    bool waited = false;
+    while (!shutdown_.load()) {
+        monitor_cv_.wait_for(lock, options_.grow_after,
+                             [this]() { return shutdown_.load() || grow_requested_.exchange(false); });
+        if (shutdown_.load()) {
+            break;
+        }
+
+        size_t live = live_workers_.load();
+        size_t queued = queued_tasks();
+        bool saturated = queued > 0 && busy_workers_.load() >= live;
+        // a deep queue gets a worker at once, otherwise tasks must have waited a whole period
+        if (saturated && live < max_threads_ && (queued >= options_.grow_depth || waited)) {
+            auto slot = std::find(active_.begin() + static_cast<std::ptrdiff_t>(num_threads_), active_.end(), false);
+            start_worker(static_cast<size_t>(slot - active_.begin()));
+            saturated = false;
+        }
+        waited = saturated;
+    }
+}
+
+void ThreadPool::request_growth() {
+    if (!elastic_ || busy_workers_.load(std::memory_order_relaxed) < live_workers_.load(std::memory_order_relaxed)) {
+        return;
+    }
+    // only the submit that raises the flag pays for the lock, which keeps the wakeup from being lost
+    if (!grow_requested_.load(std::memory_order_relaxed) && !grow_requested_.exchange(true)) {
+        { std::lock_guard<std::mutex> lock(workers_mutex_); }
+        monitor_cv_.notify_one();
+    }
+}
+
+size_t ThreadPool::queued_tasks() const {
+    size_t queued = queue_->depth();
+    for (auto levels = local_levels_.load() | node_levels_.load(); levels != 0; levels &= levels - 1) {
+        size_t level = LevelMask::first(levels);
+        queued += local_pending_[level].load() + node_pending_[level].load();
+    }
+    return queued;
+}
+
+void ThreadPool::place_workers() {
+    for (const auto &cpus : options_.cpu_sets) {
+        if (cpus.empty() || std::ranges::any_of(cpus, [](int cpu) { return cpu < 0; })) {
+            throw std::invalid_argument("CPU set must be a non-empty list of CPU numbers");
+        }
+    }
+
+    worker_node_.assign(max_threads_, 0);
+    placement_.assign(max_threads_, {});
+    if (options_.numa_aware) {
+        node_cpus_ = options_.topology ? options_.topology->nodes : Topology::detect().nodes;
+        if (node_cpus_.empty() || std::ranges::any_of(node_cpus_, [](const CpuSet &cpus) { return cpus.empty(); })) {
+            throw std::invalid_argument("Every NUMA node must have CPUs");
+        }
+        for (size_t i = 0; i < max_threads_; ++i) {
+            worker_node_[i] = i % node_cpus_.size();
+            placement_[i] = node_cpus_[worker_node_[i]];
+        }
+        // a CPU listed under several nodes counts for the first
+        for (size_t n = node_cpus_.size(); n-- > 0;) {
+            for (int cpu : node_cpus_[n]) {
+                if (static_cast<size_t>(cpu) >= cpu_node_.size()) {
+                    cpu_node_.resize(static_cast<size_t>(cpu) + 1, 0);
+                }
+                cpu_node_[static_cast<size_t>(cpu)] = n;
+            }
+        }
+    }
+    if (!options_.cpu_sets.empty()) {
+        for (size_t i = 0; i < max_threads_; ++i) {
+            placement_[i] = options_.cpu_sets[i % options_.cpu_sets.size()];
+        }
     }
+
+    victims_.resize(max_threads_);
+    for (size_t i = 0; i < max_threads_; ++i) {
+        for (size_t offset = 1; offset < max_threads_; ++offset) {
+            victims_[i].push_back((i + offset) % max_threads_);
+        }
+        // stable, so peers of one node keep the rotated order that spreads thieves over victims
+        std::ranges::stable_partition(victims_[i],
+                                      [&](size_t victim) { return worker_node_[victim] == worker_node_[i]; });
+    }
+}
+
+void ThreadPool::build_local_state() {
+    // node lanes would get around the fair and aging policies, which only see the shared lanes
+    bool split = node_cpus_.size() > 1 && queue_->strict();
+    if (options_.work_stealing) {
+        local_.resize(max_threads_);
+    }
+    if (split) {
+        nodes_.resize(node_cpus_.size());
+    }
+    auto build = [this, split](size_t node) {
+        for (size_t i = 0; i < local_.size(); ++i) {
+            if (worker_node_[i] == node) {
+                local_[i] = std::make_unique<Worker>();
+            }
+        }
+        if (split) {
+            auto lanes = std::make_unique<Node>();
+            for (size_t level = 0; level < kTaskPriorityCount; ++level) {
+                lanes->lanes[level] = queue_->make_shard(static_cast<TaskPriority>(level));
+            }
+            nodes_[node] = std::move(lanes);
+        }
+    };
+    if (node_cpus_.size() <= 1) {
+        build(0);
+        return;
+    }
+
+    // Built on a thread pinned to the node, so that the pages are first touched, and placed, there.
+    // The deques' and queues' own blocks are allocated by the workers and submitters using them.
+    std::vector<std::exception_ptr> errors(node_cpus_.size());
+    {
+        std::vector<std::jthread> builders;
+        for (size_t node = 0; node < node_cpus_.size(); ++node) {
+            builders.emplace_back([this, &build, &errors, node]() {
+                pin_current_thread(node_cpus_[node]);
+                try {
+                    build(node);
+                } catch (...) {
+                    errors[node] = std::current_exception();
+                }
+            });
+        }
+    }
+    for (const auto &error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+size_t ThreadPool::current_node() const {
+    if (current_pool == this) {
+        return worker_node_[current_index];
+    }
+    // a thread outside the pool counts for the node it happens to run on
+    int cpu = current_cpu();
+    return cpu >= 0 && static_cast<size_t>(cpu) < cpu_node_.size() ? cpu_node_[static_cast<size_t>(cpu)] : 0;
 }
 
-void ThreadPool::worker_function() {
+void ThreadPool::pin(size_t index) const {
+    // a failed pin (CPUs outside the process's cpuset) leaves the worker unpinned rather than failing the pool
+    if (!placement_[index].empty()) {
+        pin_current_thread(placement_[index]);
+    }
+}
+
+void ThreadPool::submit(TaskPriority priority, Task task) {
+    if (!scanning_) {
+        queue_->push(priority, std::move(task));
+        request_growth();
+        return;
+    }
+
+    if (!push_local(priority, std::span<Task>(&task, 1)) && !push_node(priority, std::span<Task>(&task, 1))) {
+        queue_->push(priority, std::move(task));
+    }
+    notify_work();
+    request_growth();
+}
+
+void ThreadPool::submit_serialized(TaskPriority priority, queue::SerializedTask task) {
+    queue_->push_serialized(priority, std::move(task));
+    if (scanning_) {
+        notify_work();
+    }
+    request_growth();
+}
+
+void ThreadPool::submit_deadline(TaskPriority priority, Task task, std::chrono::steady_clock::time_point deadline) {
+    queue_->push_deadline(priority, std::move(task), deadline);
+    if (scanning_) {
+        notify_work();
+    }
+    request_growth();
+}
+
+bool ThreadPool::submit_until(TaskPriority priority, Task &task, std::chrono::steady_clock::time_point deadline) {
+    if (!scanning_) {
+        bool accepted = queue_->push_until(priority, task, deadline);
+        request_growth();
+        return accepted;
+    }
+
+    if (!push_local(priority, std::span<Task>(&task, 1)) && !push_node(priority, std::span<Task>(&task, 1)) &&
+        !queue_->push_until(priority, task, deadline)) {
+        return false;
+    }
+    notify_work();
+    request_growth();
+    return true;
+}
+
+void ThreadPool::submit_bulk(TaskPriority priority, std::span<Task> tasks) {
+    if (!scanning_) {
+        queue_->push_bulk(priority, tasks);
+        request_growth();
+        return;
+    }
+
+    if (!push_local(priority, tasks) && !push_node(priority, tasks)) {
+        queue_->push_bulk(priority, tasks);
+    }
+    notify_work(tasks.size());
+    request_growth();
+}
+
+size_t ThreadPool::try_submit_bulk(TaskPriority priority, std::span<Task> tasks) {
+    size_t accepted = tasks.size();
+    if (!scanning_) {
+        accepted = queue_->try_push_bulk(priority, tasks);
+        request_growth();
+        return accepted;
+    }
+
+    if (!push_local(priority, tasks) && !push_node(priority, tasks)) {
+        accepted = queue_->try_push_bulk(priority, tasks);
+    }
+    notify_work(accepted);
+    request_growth();
+    return accepted;
+}
+
+bool ThreadPool::push_local(TaskPriority priority, std::span<Task> tasks) {
+    if (current_pool != this || local_.empty()) {
+        return false;
+    }
+    if (!queue_->has_lane(priority)) {
+        throw std::invalid_argument("Unknown task priority");
+    }
+    // a rate limit is enforced where the shared lane is popped, a worker's own deque would bypass it
+    if (queue_->rate_limited(priority)) {
+        return false;
+    }
+
+    auto index = static_cast<size_t>(priority);
+    metrics::Metrics::stamp(tasks);
+    queue_->metrics().enqueued(index, tasks.size());
+    local_pending_[index].fetch_add(tasks.size());
+    local_[current_index]->deques[index].push_bulk(tasks);
+    local_levels_.mark(index);
+    return true;
+}
+
+bool ThreadPool::push_node(TaskPriority priority, std::span<Task> tasks) {
+    auto index = static_cast<size_t>(priority);
+    // after shutdown the shared queue turns the tasks away
+    if (nodes_.empty() || index >= kTaskPriorityCount || shutdown_.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    auto &lane = nodes_[current_node()]->lanes[index];
+    if (!lane) {
+        return false;
+    }
+
+    metrics::Metrics::stamp(tasks);
+    queue_->metrics().enqueued(index, tasks.size());
+    node_pending_[index].fetch_add(tasks.size());
+    lane->try_push_bulk(tasks);
+    node_levels_.mark(index);
+    return true;
+}
+
+std::optional<Task> ThreadPool::pop_node(size_t node, size_t level) {
+    const auto &lane = nodes_[node]->lanes[level];
+    if (!lane) {
+        return std::nullopt;
+    }
+    auto task = lane->try_pop();
+    if (task) {
+        queue_->metrics().dequeued(level, *task);
+        if (node_pending_[level].fetch_sub(1) == 1 && node_levels_.clear(level, node_pending_[level])) {
+            notify_work();
+        }
+    }
+    return task;
+}
+
+size_t ThreadPool::local_pending(TaskPriority priority) const {
+    auto level = static_cast<size_t>(priority);
+    return level < local_pending_.size() ? local_pending_[level].load() + node_pending_[level].load() : 0;
+}
+
+void ThreadPool::take_local(size_t level, const Task &task) {
+    queue_->metrics().dequeued(level, task);
+    if (local_pending_[level].fetch_sub(1) == 1 && local_levels_.clear(level, local_pending_[level])) {
+        notify_work();
+    }
+}
+
+void ThreadPool::run(metrics::WorkerMetrics &worker, Task &task) {
+    if (elastic_) {
+        busy_workers_.fetch_add(1, std::memory_order_relaxed);
+    }
+    auto started = worker.begin_task();
+    run_task(task);
+    worker.end_task(started);
+    if (elastic_) {
+        busy_workers_.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+void ThreadPool::worker_function(size_t index) {
+    pin(index);
+    auto &worker = queue_->metrics().worker(index);
+    worker.start();
+    bool extra = index >= num_threads_;
+
     while (!shutdown_.load(std::memory_order_acquire)) {
-        auto task = queue_->pop();
+        auto task = extra ? queue_->pop_until(std::chrono::steady_clock::now() + options_.idle_timeout) : queue_->pop();
 
         if (task.has_value()) {
-            try {
-                (*task)();
-            } catch (const std::exception &e) {
-                std::println(std::cerr, "Exception in thread pool task: {}", e.what());
-            } catch (...) {
-                std::println(std::cerr, "Unknown exception in thread pool task");
-            }
+            run(worker, *task);
         } else {
             break;
         }
     }
+    if (extra) {
+        retire(index);
+    }
+}
+
+void ThreadPool::scanning_worker_function(size_t index) {
+    // pinned before the first push, so the deque's blocks are first touched on the worker's own node
+    pin(index);
+    current_pool = this;
+    current_index = index;
+    auto &worker = queue_->metrics().worker(index);
+    worker.start();
+    bool extra = index >= num_threads_;
+
+    while (!shutdown_.load(std::memory_order_acquire)) {
+        if (auto task = find_task(index)) {
+            run(worker, *task);
+        } else if (!has_work()) {
+            // a set bit means a level was re-marked while we scanned it, so look again instead of sleeping
+            auto deadline = extra ? std::chrono::steady_clock::now() + options_.idle_timeout
+                                  : std::chrono::steady_clock::time_point::max();
+            if (!wait_for_work(deadline)) {
+                break;  // every deque is empty, so nothing is left behind in ours
+            }
+        }
+    }
+    if (extra) {
+        retire(index);
+    }
+}
+
+std::optional<Task> ThreadPool::find_task(size_t index) {
+    // a fair or aging queue decides itself which shared lane goes next
+    if (!queue_->strict()) {
+        if (auto task = queue_->try_pop()) {
+            return task;
+        }
+    }
+
+    // A priority level is exhausted everywhere (own deque and node, shared lane, peers, other nodes)
+    // before looking at the next one, so higher priority work still wins across the whole pool; only
+    // levels that may hold work are visited.
+    size_t node = worker_node_[index];
+    for (auto levels = local_levels_.load() | node_levels_.load() | queue_->pending_levels(); levels != 0;
+         levels &= levels - 1) {
+        size_t level = LevelMask::first(levels);
+
+        if (!local_.empty()) {
+            if (auto task = local_[index]->deques[level].pop()) {
+                take_local(level, *task);
+                return task;
+            }
+        }
+
+        bool on_nodes = !nodes_.empty() && node_pending_[level].load() > 0;
+        if (on_nodes) {
+            if (auto task = pop_node(node, level)) {
+                return task;
+            }
+        }
+
+        if (auto task = queue_->try_pop(static_cast<TaskPriority>(level))) {
+            return task;
+        }
+
+        if (!local_.empty() && local_pending_[level].load() > 0) {
+            for (size_t victim : victims_[index]) {
+                if (auto task = local_[victim]->deques[level].steal()) {
+                    take_local(level, *task);
+                    return task;
+                }
+            }
+        }
+
+        // the node has nothing of this level left, so help another one
+        if (on_nodes) {
+            for (size_t offset = 1; offset < nodes_.size(); ++offset) {
+                if (auto task = pop_node((node + offset) % nodes_.size(), level)) {
+                    return task;
+                }
+            }
+        }
+    }
+    return std::nullopt;
+}
+
+bool ThreadPool::has_work() const {
+    return (local_levels_.load() | node_levels_.load() | queue_->pending_levels()) != 0 || shutdown_.load();
+}
+
+bool ThreadPool::wait_for_work(std::chrono::steady_clock::time_point deadline) {
+    if (queue_->idle_strategy().spin_until([this]() { return has_work(); })) {
+        return true;
+    }
+
+    // a submit marks its level before notifying, so it either sees us registered or we see its bit
+    auto key = work_available_.prepare_wait();
+    if (has_work()) {
+        work_available_.cancel_wait();
+        return true;
+    }
+    // a lane out of tokens is not announced when it refills, so sleep no longer than until then
+    auto wake = std::min(deadline, queue_->next_refill());
+    if (wake == std::chrono::steady_clock::time_point::max()) {
+        work_available_.wait(key);
+        return true;
+    }
+    return work_available_.wait_until(key, wake) || wake != deadline;
+}
+
+void ThreadPool::notify_work(size_t count) {
+    if (count == 1) {
+        work_available_.notify_one();
+    } else {
+        work_available_.notify(count);
+    }
 }
 
 ThreadPool::~ThreadPool() {
     shutdown_.store(true, std::memory_order_release);
     queue_->shutdown();
+    if (scanning_) {
+        work_available_.notify_all();
+    }
+    if (monitor_.joinable()) {
+        { std::lock_guard<std::mutex> lock(workers_mutex_); }
+        monitor_cv_.notify_all();
+        monitor_.join();
+    }
+    // join before the deques and the idle state the workers use are destroyed; a retiring worker
+    // still takes workers_mutex_, so the threads are joined outside of it
+    std::vector<std::jthread> workers;
+    {
+        std::lock_guard<std::mutex> lock(workers_mutex_);
+        workers.swap(workers_);
+    }
+    workers.clear();
 }
 
-}  // namespace dispatcher::thread_pool
\ No newline at end of file
+}  // namespace dispatcher::thread_pool
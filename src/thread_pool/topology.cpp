@@ -0,0 +1,149 @@
+#include "thread_pool/topology.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace dispatcher::thread_pool {
+
+namespace {
+
+int parse_cpu(std::string_view text) {
+    int cpu = -1;
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), cpu);
+    if (error != std::errc() || end != text.data() + text.size() || cpu < 0) {
+        throw std::invalid_argument("Malformed CPU list");
+    }
+    return cpu;
+}
+
+CpuSet allowed_cpus() {
+    CpuSet cpus;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+#endif
+    if (cpus.empty()) {
+        for (unsigned cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); ++cpu) {
+            cpus.push_back(static_cast<int>(cpu));
+        }
+    }
+    return cpus;
+}
+
+}  // namespace
+
+CpuSet parse_cpu_list(std::string_view list) {
+    CpuSet cpus;
+    while (!list.empty() && (list.back() == '\n' || list.back() == ' ')) {
+        list.remove_suffix(1);
+    }
+    while (!list.empty()) {
+        auto comma = list.find(',');
+        auto range = list.substr(0, comma);
+        list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+
+        auto dash = range.find('-');
+        int first = parse_cpu(range.substr(0, dash));
+        int last = dash == std::string_view::npos ? first : parse_cpu(range.substr(dash + 1));
+        if (last < first) {
+            throw std::invalid_argument("Malformed CPU list");
+        }
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    std::ranges::sort(cpus);
+    cpus.erase(std::ranges::unique(cpus).begin(), cpus.end());
+    return cpus;
+}
+
+Topology Topology::detect(const std::filesystem::path &root) {
+    // node directories sorted by number, not by name: node10 comes after node9
+    std::map<int, CpuSet> nodes;
+    std::error_code error;
+    for (const auto &entry : std::filesystem::directory_iterator(root, error)) {
+        auto name = entry.path().filename().string();
+        if (!name.starts_with("node") || name.size() == 4) {
+            continue;
+        }
+        int node = 0;
+        auto [end, parse_error] = std::from_chars(name.data() + 4, name.data() + name.size(), node);
+        if (parse_error != std::errc() || end != name.data() + name.size()) {
+            continue;
+        }
+
+        std::ifstream file(entry.path() / "cpulist");
+        std::string list;
+        if (!file || !std::getline(file, list)) {
+            continue;
+        }
+        try {
+            if (auto cpus = parse_cpu_list(list); !cpus.empty()) {
+                nodes[node] = std::move(cpus);  // memory-only nodes have no CPUs and are skipped
+            }
+        } catch (const std::invalid_argument &) {
+            continue;
+        }
+    }
+
+    Topology topology;
+    for (auto &[node, cpus] : nodes) {
+        topology.nodes.push_back(std::move(cpus));
+    }
+    if (topology.nodes.empty()) {
+        topology.nodes.push_back(allowed_cpus());
+    }
+    return topology;
+}
+
+bool pin_current_thread(const CpuSet &cpus) {
+#ifdef __linux__
+    if (cpus.empty()) {
+        return false;
+    }
+    int max_cpu = *std::ranges::max_element(cpus);
+    cpu_set_t *set = CPU_ALLOC(max_cpu + 1);
+    if (!set) {
+        return false;
+    }
+    size_t size = CPU_ALLOC_SIZE(max_cpu + 1);
+    CPU_ZERO_S(size, set);
+    for (int cpu : cpus) {
+        CPU_SET_S(cpu, size, set);
+    }
+    // the kernel intersects the set with the CPUs the process may use and fails only when nothing is left
+    bool pinned = pthread_setaffinity_np(pthread_self(), size, set) == 0;
+    CPU_FREE(set);
+    return pinned;
+#else
+    (void)cpus;
+    return false;
+#endif
+}
+
+int current_cpu() {
+#ifdef __linux__
+    return sched_getcpu();
+#else
+    return -1;
+#endif
+}
+
+}  // namespace dispatcher::thread_pool
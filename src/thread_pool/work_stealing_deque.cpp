@@ -0,0 +1,41 @@
+#include "thread_pool/work_stealing_deque.hpp"
+
+namespace dispatcher::thread_pool {
+
+void WorkStealingDeque::push(Task task) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(std::move(task));
+}
+
+void WorkStealingDeque::push_bulk(std::span<Task> tasks) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &task : tasks) {
+        tasks_.push_back(std::move(task));
+    }
+}
+
+std::optional<Task> WorkStealingDeque::pop() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (tasks_.empty()) {
+        return std::nullopt;
+    }
+
+    auto task = std::move(tasks_.back());
+    tasks_.pop_back();
+    return task;
+}
+
+std::optional<Task> WorkStealingDeque::steal() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (tasks_.empty()) {
+        return std::nullopt;
+    }
+
+    auto task = std::move(tasks_.front());
+    tasks_.pop_front();
+    return task;
+}
+
+}  // namespace dispatcher::thread_pool
@@ -0,0 +1,109 @@
+#include "timer/timer_service.hpp"
+#include <iostream>
+#include <print>
+#include <stdexcept>
+
+namespace dispatcher::timer {
+
+bool TimerHandle::cancel() {
+    auto service = service_.lock();
+    return service && service->cancel(id_);
+}
+
+TimerService::TimerService(detail::Executor executor, Clock::duration tick)
+    : executor_(executor), tick_(tick), start_(Clock::now()) {
+    if (tick_ <= Clock::duration::zero()) {
+        throw std::invalid_argument("Timer tick must be positive");
+    }
+    thread_ = std::jthread(&TimerService::timer_function, this);
+}
+
+TimingWheel::Tick TimerService::to_tick(Clock::time_point time, bool round_up) const {
+    auto elapsed = time - start_;
+    if (elapsed <= Clock::duration::zero()) {
+        return 0;
+    }
+    auto ticks = elapsed / tick_;
+    if (round_up && elapsed % tick_ != Clock::duration::zero()) {
+        ++ticks;
+    }
+    return static_cast<TimingWheel::Tick>(ticks);
+}
+
+TimerHandle TimerService::add(Clock::time_point when, TaskPriority priority, Task task, Clock::duration period) {
+    if (period < Clock::duration::zero()) {
+        throw std::invalid_argument("Timer period must not be negative");
+    }
+    // a period shorter than a tick still fires once per tick
+    TimingWheel::Tick period_ticks = 0;
+    if (period > Clock::duration::zero()) {
+        period_ticks = std::max<TimingWheel::Tick>(1, period / tick_);
+    }
+
+    // rounding up keeps a timer from firing before its time point
+    auto deadline = to_tick(when, true);
+    TimerId id;
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        id = wheel_.insert(deadline, priority, std::move(task), period_ticks);
+        wake = deadline < sleep_until_;
+    }
+    if (wake) {
+        wake_.notify_one();
+    }
+    return {weak_from_this(), id};
+}
+
+bool TimerService::cancel(TimerId id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return wheel_.cancel(id);
+}
+
+void TimerService::timer_function() {
+    std::vector<DueTask> due;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_) {
+        wheel_.advance(to_tick(Clock::now(), false), due);
+        if (!due.empty()) {
+            lock.unlock();
+            for (auto &[priority, task] : due) {
+                try {
+                    executor_.schedule(executor_.context, priority, std::move(task));
+                } catch (const std::exception &e) {
+                    std::println(std::cerr, "Exception while scheduling a timer task: {}", e.what());
+                }
+            }
+            due.clear();
+            lock.lock();
+            continue;
+        }
+
+        auto next = wheel_.next_event();
+        sleep_until_ = next.value_or(std::numeric_limits<TimingWheel::Tick>::max());
+        if (next) {
+            wake_.wait_until(lock, start_ + *next * tick_);
+        } else {
+            wake_.wait(lock);
+        }
+        sleep_until_ = std::numeric_limits<TimingWheel::Tick>::max();
+    }
+}
+
+void TimerService::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stop_) {
+            return;
+        }
+        stop_ = true;
+    }
+    wake_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+TimerService::~TimerService() { shutdown(); }
+
+}  // namespace dispatcher::timer
@@ -0,0 +1,190 @@
+#include "timer/timing_wheel.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace dispatcher::timer {
+
+uint32_t TimingWheel::allocate() {
+    if (free_ != kNone) {
+        uint32_t index = free_;
+        free_ = nodes_[index].next;
+        return index;
+    }
+    if (nodes_.size() >= kNone) {
+        throw std::length_error("Too many pending timers");
+    }
+    nodes_.emplace_back();
+    return static_cast<uint32_t>(nodes_.size() - 1);
+}
+
+void TimingWheel::release(uint32_t index) {
+    auto &node = nodes_[index];
+    node.task.reset();
+    node.periodic.reset();
+    ++node.generation;
+    node.next = free_;
+    free_ = index;
+    --size_;
+}
+
+void TimingWheel::link(uint32_t index) {
+    auto &node = nodes_[index];
+    // a timer cascading down on its own deadline lands in the slot expired right after the cascade
+    Tick delta = std::max<Tick>(node.deadline - now_, 0);
+    Tick target = now_ + delta;
+
+    size_t level = 0;
+    while (level + 1 < kLevels && delta >= Tick{1} << (kSlotBits * (level + 1))) {
+        ++level;
+    }
+    if (level + 1 == kLevels) {
+        // farther than the wheel reaches: park in the top level, the cascade re-links it
+        Tick reach = (Tick{1} << (kSlotBits * kLevels)) - 1;
+        target = now_ + std::min(delta, reach);
+    }
+
+    size_t slot = level * kSlots + ((target >> (kSlotBits * level)) & (kSlots - 1));
+    node.slot = static_cast<uint16_t>(slot);
+    node.prev = kNone;
+    node.next = slots_[slot];
+    if (node.next != kNone) {
+        nodes_[node.next].prev = index;
+    }
+    slots_[slot] = index;
+    node.linked = true;
+}
+
+void TimingWheel::unlink(uint32_t index) {
+    auto &node = nodes_[index];
+    if (node.prev != kNone) {
+        nodes_[node.prev].next = node.next;
+    } else {
+        slots_[node.slot] = node.next;
+    }
+    if (node.next != kNone) {
+        nodes_[node.next].prev = node.prev;
+    }
+    node.linked = false;
+}
+
+TimerId TimingWheel::insert(Tick deadline, TaskPriority priority, Task task, Tick period) {
+    if (period < 0) {
+        throw std::invalid_argument("Timer period must not be negative");
+    }
+
+    uint32_t index = allocate();
+    auto &node = nodes_[index];
+    // the current tick is already expired, so a deadline that passed fires on the next one
+    node.deadline = std::max(deadline, now_ + 1);
+    node.period = period;
+    node.priority = priority;
+    if (period > 0) {
+        node.periodic = std::make_shared<Task>(std::move(task));
+    } else {
+        node.task = std::move(task);
+    }
+    ++size_;
+    link(index);
+    return {index, node.generation};
+}
+
+bool TimingWheel::cancel(TimerId id) {
+    if (id.index >= nodes_.size()) {
+        return false;
+    }
+    auto &node = nodes_[id.index];
+    if (node.generation != id.generation || !node.linked) {
+        return false;
+    }
+    unlink(id.index);
+    release(id.index);
+    return true;
+}
+
+void TimingWheel::cascade(size_t level) {
+    size_t slot = level * kSlots + ((now_ >> (kSlotBits * level)) & (kSlots - 1));
+    uint32_t index = std::exchange(slots_[slot], kNone);
+    while (index != kNone) {
+        uint32_t next = nodes_[index].next;
+        link(index);
+        index = next;
+    }
+}
+
+void TimingWheel::expire(Tick until, std::vector<DueTask> &due) {
+    uint32_t index = std::exchange(slots_[now_ & (kSlots - 1)], kNone);
+    while (index != kNone) {
+        auto &node = nodes_[index];
+        uint32_t next = node.next;
+        node.linked = false;
+
+        if (node.period > 0) {
+            due.push_back({node.priority, [task = node.periodic]() { (*task)(); }});
+            // periods missed up to `until` are skipped instead of fired in a burst
+            node.deadline += node.period;
+            if (node.deadline <= until) {
+                node.deadline += ((until - node.deadline) / node.period + 1) * node.period;
+            }
+            link(index);
+        } else {
+            due.push_back({node.priority, std::move(node.task)});
+            release(index);
+        }
+        index = next;
+    }
+}
+
+void TimingWheel::advance(Tick tick, std::vector<DueTask> &due) {
+    while (now_ < tick) {
+        auto next = next_event();
+        if (!next || *next > tick) {
+            now_ = tick;
+            return;
+        }
+        // nothing is cascaded or expired before `next`, so the ticks in between are skipped
+        now_ = *next;
+        // a level is due for a cascade when every level below it has wrapped around
+        for (size_t level = 1; level < kLevels; ++level) {
+            if (now_ & ((Tick{1} << (kSlotBits * level)) - 1)) {
+                break;
+            }
+            cascade(level);
+        }
+        expire(tick, due);
+    }
+}
+
+std::optional<TimingWheel::Tick> TimingWheel::next_event() const {
+    if (size_ == 0) {
+        return std::nullopt;
+    }
+
+    // level 0 slots other than the current one hold timers due within the next kSlots ticks
+    std::optional<Tick> next;
+    for (Tick tick = now_ + 1; tick < now_ + Tick{kSlots}; ++tick) {
+        if (slots_[tick & (kSlots - 1)] != kNone) {
+            next = tick;
+            break;
+        }
+    }
+    // slot k of a higher level is cascaded at tick k << (kSlotBits * level); a whole turn of the level
+    // is looked at, since a slot past its wrap-around may still cascade before anything above it does
+    for (size_t level = 1; level < kLevels; ++level) {
+        size_t shift = kSlotBits * level;
+        Tick base = now_ >> shift;
+        for (Tick k = base + 1; k <= base + Tick{kSlots}; ++k) {
+            Tick tick = k << shift;
+            if (next && tick >= *next) {
+                break;
+            }
+            if (slots_[level * kSlots + (k & (kSlots - 1))] != kNone) {
+                next = tick;
+                break;
+            }
+        }
+    }
+    // every pending timer is linked into a slot found above
+    return next;
+}
+
+}  // namespace dispatcher::timer
@@ -0,0 +1,46 @@
+#include "allocation_counter.hpp"
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+thread_local bool count_allocations = false;
+thread_local size_t allocations = 0;
+
+}  // namespace
+
+namespace test {
+
+AllocationCounter::AllocationCounter() {
+    allocations = 0;
+    count_allocations = true;
+}
+
+AllocationCounter::~AllocationCounter() { count_allocations = false; }
+
+size_t AllocationCounter::count() const { return allocations; }
+
+}  // namespace test
+
+void *operator new(size_t size) {
+    if (count_allocations) {
+        ++allocations;
+    }
+    if (void *ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+
+// std::stable_partition and friends take scratch space from the nothrow form; it must come from
+// malloc as well, since the replaced delete frees it
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+    if (count_allocations) {
+        ++allocations;
+    }
+    return std::malloc(size == 0 ? 1 : size);
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+
+namespace test {
+
+// counts heap allocations made by the current thread while it is alive;
+// the replaced global operator new lives in allocation_counter.cpp
+class AllocationCounter {
+public:
+    AllocationCounter();
+    ~AllocationCounter();
+
+    size_t count() const;
+};
+
+}  // namespace test
@@ -0,0 +1,132 @@
+#include "async_task.hpp"
+#include "task_dispatcher.hpp"
+#include <future>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace dispatcher;
+
+namespace {
+
+AsyncTask<std::thread::id> hop(TaskDispatcher &dispatcher, TaskPriority priority) {
+    co_await dispatcher.schedule_on(priority);
+    co_return std::this_thread::get_id();
+}
+
+AsyncTask<int> add_one(int value) {
+    co_return value + 1;
+}
+
+AsyncTask<int> fail() {
+    throw std::runtime_error("boom");
+    co_return 0;
+}
+
+}  // namespace
+
+TEST(AsyncTaskTest, scheduleOnResumesOnWorker) {
+    TaskDispatcher dispatcher(2);
+
+    auto future = dispatcher.spawn(TaskPriority::Normal, hop(dispatcher, TaskPriority::High));
+    EXPECT_NE(future.get(), std::this_thread::get_id());
+}
+
+TEST(AsyncTaskTest, nestedTasksReturnValues) {
+    TaskDispatcher dispatcher(2);
+
+    auto chain = [](TaskDispatcher &dispatcher) -> AsyncTask<int> {
+        int value = 0;
+        for (int i = 0; i < 10000; ++i) {
+            value = co_await add_one(value);
+        }
+        co_await dispatcher.schedule_on(TaskPriority::High);
+        co_return value;
+    };
+
+    EXPECT_EQ(dispatcher.spawn(TaskPriority::Normal, chain(dispatcher)).get(), 10000);
+}
+
+TEST(AsyncTaskTest, exceptionPropagatesToAwaiter) {
+    TaskDispatcher dispatcher(2);
+
+    auto catcher = []() -> AsyncTask<bool> {
+        try {
+            co_await fail();
+        } catch (const std::runtime_error &) {
+            co_return true;
+        }
+        co_return false;
+    };
+
+    EXPECT_TRUE(dispatcher.spawn(TaskPriority::Normal, catcher()).get());
+    auto failing = dispatcher.spawn(TaskPriority::Normal, fail());
+    EXPECT_THROW(failing.get(), std::runtime_error);
+}
+
+TEST(AsyncTaskTest, manyCoroutinesOnFewWorkers) {
+    TaskDispatcher dispatcher(2);
+    constexpr int kCoroutines = 1000;
+    constexpr int kHops = 10;
+
+    auto worker = [](TaskDispatcher &dispatcher, int id) -> AsyncTask<int> {
+        for (int i = 0; i < kHops; ++i) {
+            co_await dispatcher.schedule_on(i % 2 ? TaskPriority::High : TaskPriority::Normal);
+        }
+        co_return id;
+    };
+
+    std::vector<Future<int>> futures;
+    for (int i = 0; i < kCoroutines; ++i) {
+        futures.push_back(dispatcher.spawn(TaskPriority::Normal, worker(dispatcher, i)));
+    }
+    long long sum = 0;
+    for (auto &future : futures) {
+        sum += future.get();
+    }
+    EXPECT_EQ(sum, 1LL * kCoroutines * (kCoroutines - 1) / 2);
+}
+
+TEST(AsyncTaskTest, voidTaskWithFutureContinuation) {
+    TaskDispatcher dispatcher(2);
+    std::atomic<int> counter{0};
+
+    auto body = [](TaskDispatcher &dispatcher, std::atomic<int> &counter) -> AsyncTask<> {
+        co_await dispatcher.schedule_on(TaskPriority::High);
+        counter.fetch_add(1);
+    };
+
+    auto future = dispatcher.spawn(TaskPriority::Normal, body(dispatcher, counter)).then([&counter]() {
+        return counter.load();
+    });
+    EXPECT_EQ(future.get(), 1);
+}
+
+TEST(AsyncTaskTest, droppedResumptionDestroysFrame) {
+    queue::QueueOptions rejecting{true, 1, queue::QueueType::Mutex, 1, queue::OverflowPolicy::Reject};
+    TaskDispatcher dispatcher(1, {{TaskPriority::High, rejecting}, {TaskPriority::Normal, {false, {}}}});
+    std::atomic<bool> destroyed{false};
+
+    struct Guard {
+        std::atomic<bool> &destroyed;
+        ~Guard() { destroyed = true; }
+    };
+
+    auto body = [](TaskDispatcher &dispatcher, std::atomic<bool> &destroyed) -> AsyncTask<int> {
+        Guard guard{destroyed};
+        // the only worker is running this coroutine, so the filler keeps the lane full
+        EXPECT_TRUE(dispatcher.try_schedule(TaskPriority::High, []() {}));
+        co_await dispatcher.schedule_on(TaskPriority::High);
+        co_return 1;
+    };
+
+    auto future = dispatcher.spawn(TaskPriority::Normal, body(dispatcher, destroyed));
+    try {
+        future.get();
+        FAIL() << "the rejected resumption must break the promise";
+    } catch (const std::future_error &error) {
+        EXPECT_EQ(error.code(), std::future_errc::broken_promise);
+    }
+    EXPECT_TRUE(destroyed.load());
+}
@@ -0,0 +1,124 @@
+#include "future.hpp"
+#include "allocation_counter.hpp"
+#include "task_dispatcher.hpp"
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+using namespace dispatcher;
+using namespace queue;
+using test::AllocationCounter;
+
+TEST(FutureTest, submitReturnsValue) {
+    TaskDispatcher dispatcher(2);
+
+    auto future = dispatcher.submit(TaskPriority::Normal, []() { return 42; });
+    ASSERT_TRUE(future.valid());
+    EXPECT_EQ(future.get(), 42);
+    EXPECT_FALSE(future.valid());
+    EXPECT_THROW(future.get(), std::future_error);
+}
+
+TEST(FutureTest, submitVoidAndMoveOnlyResult) {
+    TaskDispatcher dispatcher(2);
+    std::atomic<bool> executed{false};
+
+    auto done = dispatcher.submit(TaskPriority::High, [&executed]() { executed = true; });
+    done.get();
+    EXPECT_TRUE(executed.load());
+
+    auto pointer = dispatcher.submit(TaskPriority::Normal, []() { return std::make_unique<int>(5); });
+    EXPECT_EQ(*pointer.get(), 5);
+}
+
+TEST(FutureTest, exceptionIsStored) {
+    TaskDispatcher dispatcher(2);
+
+    auto future = dispatcher.submit(TaskPriority::Normal, []() -> int { throw std::runtime_error("boom"); });
+    EXPECT_THROW(future.get(), std::runtime_error);
+}
+
+TEST(FutureTest, thenRunsOnDispatcher) {
+    TaskDispatcher dispatcher(2);
+    auto caller = std::this_thread::get_id();
+    std::atomic<bool> continuation_on_caller{true};
+
+    auto future = dispatcher.submit(TaskPriority::Normal, []() { return 20; })
+                      .then([](int value) { return value + 1; })
+                      .then(TaskPriority::High, [&continuation_on_caller, caller](int value) {
+                          continuation_on_caller = std::this_thread::get_id() == caller;
+                          return std::to_string(value * 2);
+                      });
+
+    EXPECT_EQ(future.get(), "42");
+    EXPECT_FALSE(continuation_on_caller.load());
+}
+
+TEST(FutureTest, thenAfterReady) {
+    TaskDispatcher dispatcher(2);
+
+    auto first = dispatcher.submit(TaskPriority::Normal, []() {});
+    first.wait();
+    ASSERT_TRUE(first.is_ready());
+
+    auto second = first.then([]() { return 3; });
+    EXPECT_FALSE(first.valid());
+    EXPECT_EQ(second.get(), 3);
+}
+
+TEST(FutureTest, thenSkipsOnException) {
+    TaskDispatcher dispatcher(2);
+    std::atomic<bool> continuation_ran{false};
+
+    auto future = dispatcher.submit(TaskPriority::Normal, []() -> int { throw std::logic_error("bad"); })
+                      .then([&continuation_ran](int value) {
+                          continuation_ran = true;
+                          return value;
+                      });
+    EXPECT_THROW(future.get(), std::logic_error);
+    EXPECT_FALSE(continuation_ran.load());
+}
+
+TEST(FutureTest, brokenPromiseWhenTaskIsDropped) {
+    Future<int> future;
+    {
+        auto [pending, promise] = detail::make_future<int>({}, TaskPriority::Normal);
+        future = std::move(pending);
+    }
+    try {
+        future.get();
+        FAIL() << "expected broken promise";
+    } catch (const std::future_error &e) {
+        EXPECT_EQ(e.code(), std::future_errc::broken_promise);
+    }
+}
+
+TEST(FutureTest, submitDoesNotAllocate) {
+    TaskDispatcher dispatcher(2, {{TaskPriority::High, {true, 4096, QueueType::LockFree}},
+                                  {TaskPriority::Normal, {false, {}}}});
+    const int num_tasks = 1000;
+    std::vector<Future<int>> futures;
+    futures.reserve(num_tasks);
+
+    auto run_batch = [&dispatcher, &futures]() {
+        for (int i = 0; i < num_tasks; ++i) {
+            futures.push_back(dispatcher.submit(TaskPriority::High, [i]() { return i; }));
+        }
+        long long sum = 0;
+        for (auto &future : futures) {
+            sum += future.get();
+        }
+        futures.clear();
+        return sum;
+    };
+
+    // warm up: fill the shared state pool with blocks released by the workers
+    for (int i = 0; i < 3; ++i) {
+        run_batch();
+    }
+
+    AllocationCounter counter;
+    EXPECT_EQ(run_batch(), 1LL * num_tasks * (num_tasks - 1) / 2);
+    EXPECT_EQ(counter.count(), 0u);
+}
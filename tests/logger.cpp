@@ -0,0 +1,107 @@
+#include "logger.hpp"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+class LoggerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        path_ = std::filesystem::temp_directory_path() /
+                ("logger_test_" + std::to_string(::testing::UnitTest::GetInstance()->random_seed()) + "_" +
+                 ::testing::UnitTest::GetInstance()->current_test_info()->name() + ".log");
+        std::filesystem::remove(path_);
+    }
+
+    void TearDown() override { std::filesystem::remove(path_); }
+
+    std::vector<std::string> ReadLines() const {
+        std::ifstream file(path_);
+        std::vector<std::string> lines;
+        for (std::string line; std::getline(file, line);) {
+            lines.push_back(line);
+        }
+        return lines;
+    }
+
+    std::filesystem::path path_;
+};
+
+}  // namespace
+
+TEST_F(LoggerTest, linesFromManyThreadsKeepTheirOrder) {
+    const int num_threads = 4;
+    const int lines_per_thread = 2000;
+    {
+        AsyncLogWriter writer({.path = path_.string(), .buffer_size = 4096, .overflow = LogOverflow::Block});
+        std::vector<std::jthread> threads;
+        for (int i = 0; i < num_threads; ++i) {
+            threads.emplace_back([&writer, i]() {
+                for (int j = 0; j < lines_per_thread; ++j) {
+                    writer.Write(std::to_string(i) + " " + std::to_string(j));
+                }
+            });
+        }
+        threads.clear();
+        EXPECT_EQ(writer.Dropped(), 0u);
+    }
+
+    std::vector<int> next(num_threads, 0);
+    auto lines = ReadLines();
+    ASSERT_EQ(lines.size(), static_cast<size_t>(num_threads * lines_per_thread));
+    for (const auto &line : lines) {
+        auto space = line.find(' ');
+        ASSERT_NE(space, std::string::npos);
+        int thread = std::stoi(line.substr(0, space));
+        EXPECT_EQ(std::stoi(line.substr(space + 1)), next[thread]++);
+    }
+}
+
+TEST_F(LoggerTest, dropPolicyCountsOverflow) {
+    const int num_lines = 100;
+    size_t dropped;
+    {
+        // the flusher only runs on demand, so the 64-byte ring overflows after a few lines
+        AsyncLogWriter writer({.path = path_.string(), .buffer_size = 64, .flush_interval = std::chrono::hours(1)});
+        for (int i = 0; i < num_lines; ++i) {
+            writer.Write("0123456789");
+        }
+        dropped = writer.Dropped();
+    }
+
+    EXPECT_GT(dropped, 0u);
+    EXPECT_EQ(ReadLines().size() + dropped, static_cast<size_t>(num_lines));
+}
+
+TEST_F(LoggerTest, flushAndOversizedLines) {
+    AsyncLogWriter writer({.path = path_.string(), .buffer_size = 16, .flush_interval = std::chrono::hours(1)});
+    writer.Write("short");
+    writer.Write(std::string(100, 'x'));
+    writer.Write("tail");
+    writer.Flush();
+
+    auto lines = ReadLines();
+    ASSERT_EQ(lines.size(), 3u);
+    EXPECT_EQ(lines[0], "short");
+    EXPECT_EQ(lines[1], std::string(100, 'x'));
+    EXPECT_EQ(lines[2], "tail");
+    EXPECT_EQ(writer.Dropped(), 0u);
+
+    EXPECT_THROW(AsyncLogWriter({.buffer_size = 0}), std::invalid_argument);
+}
+
+TEST_F(LoggerTest, loggerAsyncMode) {
+    Logger::Get().EnableAsync({.path = path_.string()});
+    Logger::Get().Log("message #{}", 1);
+    Logger::Get().Log("message #2");
+    Logger::Get().Shutdown();
+
+    auto lines = ReadLines();
+    ASSERT_EQ(lines.size(), 2u);
+    EXPECT_EQ(lines[0], "message #1");
+    EXPECT_EQ(lines[1], "message #2");
+}
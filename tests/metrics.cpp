@@ -0,0 +1,154 @@
+#include "metrics.hpp"
+#include "task_dispatcher.hpp"
+#include <atomic>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+using namespace dispatcher;
+using namespace std::chrono_literals;
+
+namespace {
+
+const metrics::LaneSnapshot &lane_of(const metrics::Snapshot &snapshot, TaskPriority priority) {
+    for (const auto &lane : snapshot.lanes) {
+        if (lane.priority == priority) {
+            return lane;
+        }
+    }
+    throw std::out_of_range("no such lane");
+}
+
+void wait_for(std::atomic<int> &counter, int expected) {
+    auto deadline = std::chrono::steady_clock::now() + 5s;
+    while (counter.load() < expected && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(1ms);
+    }
+}
+
+}  // namespace
+
+TEST(HistogramTest, buckets) {
+    using metrics::HistogramSnapshot;
+
+    for (uint64_t value : {0ull, 1ull, 7ull, 8ull, 9ull, 100ull, 1000ull, 123456789ull, ~0ull}) {
+        auto bucket = HistogramSnapshot::bucket_of(value);
+        ASSERT_LT(bucket, HistogramSnapshot::kBuckets);
+        EXPECT_LE(HistogramSnapshot::lower_bound(bucket), value);
+        EXPECT_GE(HistogramSnapshot::upper_bound(bucket), value);
+        // relative error of a bucket stays within 1/kSubBuckets
+        EXPECT_LE(HistogramSnapshot::upper_bound(bucket) - HistogramSnapshot::lower_bound(bucket),
+                  value / HistogramSnapshot::kSubBuckets);
+    }
+}
+
+TEST(HistogramTest, percentile) {
+    metrics::Histogram histogram;
+    for (uint64_t value = 1; value <= 1000; ++value) {
+        histogram.record(value * 1000);
+    }
+
+    metrics::HistogramSnapshot snapshot;
+    histogram.add_to(snapshot);
+    EXPECT_EQ(snapshot.count(), 1000u);
+    EXPECT_NEAR(static_cast<double>(snapshot.percentile(0.5)), 500'000.0, 500'000.0 / 8);
+    EXPECT_NEAR(static_cast<double>(snapshot.percentile(0.99)), 990'000.0, 990'000.0 / 8);
+    EXPECT_GE(snapshot.max(), 1'000'000u);
+    EXPECT_EQ(metrics::HistogramSnapshot().percentile(0.5), 0u);
+}
+
+TEST(MetricsTest, countsLanesAndWorkers) {
+    if (!metrics::kEnabled) {
+        GTEST_SKIP() << "built without DISPATCHER_METRICS";
+    }
+
+    constexpr int kTasks = 200;
+    TaskDispatcher dispatcher(2);
+    std::atomic<int> done{0};
+    for (int i = 0; i < kTasks; ++i) {
+        dispatcher.schedule(i % 2 ? TaskPriority::High : TaskPriority::Normal, [&done]() {
+            std::this_thread::sleep_for(10us);
+            done.fetch_add(1);
+        });
+    }
+    wait_for(done, kTasks);
+    ASSERT_EQ(done.load(), kTasks);
+
+    auto snapshot = dispatcher.metrics();
+    ASSERT_EQ(snapshot.lanes.size(), 2u);
+    EXPECT_EQ(snapshot.lanes[0].priority, TaskPriority::High);
+    for (auto priority : {TaskPriority::High, TaskPriority::Normal}) {
+        const auto &lane = lane_of(snapshot, priority);
+        EXPECT_EQ(lane.enqueued, kTasks / 2u);
+        EXPECT_EQ(lane.dequeued, kTasks / 2u);
+        EXPECT_EQ(lane.rejected, 0u);
+        EXPECT_EQ(lane.depth, 0);
+        EXPECT_EQ(lane.wait_time.count(), kTasks / 2u);
+    }
+
+    ASSERT_EQ(snapshot.workers.size(), 2u);
+    uint64_t tasks = 0;
+    std::chrono::nanoseconds busy{0};
+    for (const auto &worker : snapshot.workers) {
+        tasks += worker.tasks;
+        busy += worker.busy;
+    }
+    // the last task may have bumped done before its worker finished the accounting
+    EXPECT_GE(tasks, kTasks - 2u);
+    EXPECT_GE(busy, (kTasks - 2) * 10us);
+    EXPECT_EQ(snapshot.run_time.count(), tasks);
+    EXPECT_GE(snapshot.run_time.percentile(0.5), 10'000u);
+}
+
+TEST(MetricsTest, depthAndRejections) {
+    TaskDispatcher dispatcher(1, {{TaskPriority::High, {true, 4}}, {TaskPriority::Normal, {false, {}}}});
+    std::atomic<bool> release{false};
+    std::atomic<int> started{0};
+    dispatcher.schedule(TaskPriority::Normal, [&]() {
+        started.fetch_add(1);
+        release.wait(false);
+    });
+    wait_for(started, 1);
+
+    std::vector<Task> tasks;
+    for (int i = 0; i < 6; ++i) {
+        tasks.emplace_back([]() {});
+    }
+    EXPECT_EQ(dispatcher.try_schedule_bulk(TaskPriority::High, tasks), 4u);
+
+    auto snapshot = dispatcher.metrics();
+    const auto &high = lane_of(snapshot, TaskPriority::High);
+    EXPECT_EQ(high.depth, 4);
+    if (metrics::kEnabled) {
+        EXPECT_EQ(high.enqueued, 4u);
+        EXPECT_EQ(high.rejected, 2u);
+        EXPECT_EQ(high.dequeued, 0u);
+    }
+
+    release.store(true);
+    release.notify_all();
+}
+
+TEST(MetricsTest, workStealingLocalDeques) {
+    if (!metrics::kEnabled) {
+        GTEST_SKIP() << "built without DISPATCHER_METRICS";
+    }
+
+    constexpr int kChildren = 100;
+    TaskDispatcher dispatcher(2, {{TaskPriority::Normal, {false, {}}}}, {.work_stealing = true});
+    std::atomic<int> done{0};
+    dispatcher.schedule(TaskPriority::Normal, [&]() {
+        for (int i = 0; i < kChildren; ++i) {
+            dispatcher.schedule(TaskPriority::Normal, [&done]() { done.fetch_add(1); });
+        }
+    });
+    wait_for(done, kChildren);
+    ASSERT_EQ(done.load(), kChildren);
+
+    auto snapshot = dispatcher.metrics();
+    const auto &lane = lane_of(snapshot, TaskPriority::Normal);
+    EXPECT_EQ(lane.enqueued, kChildren + 1u);
+    EXPECT_EQ(lane.dequeued, kChildren + 1u);
+    EXPECT_EQ(lane.depth, 0);
+}
@@ -0,0 +1,87 @@
+#include "parallel.hpp"
+#include <atomic>
+#include <future>
+#include <gtest/gtest.h>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace dispatcher;
+
+TEST(ParallelTest, forVisitsEveryIndexOnce) {
+    TaskDispatcher dispatcher(4);
+    for (size_t grain : {1, 7, 1000}) {
+        std::vector<std::atomic<int>> visits(10007);
+        parallel_for(dispatcher, 0, visits.size(), [&visits](size_t i) { visits[i]++; }, TaskPriority::High, grain);
+        for (auto &count : visits) {
+            ASSERT_EQ(count.load(), 1);
+        }
+    }
+
+    std::vector<int> values(1000, 1);
+    parallel_for(dispatcher, values, [](int &value) { value *= 2; });
+    EXPECT_EQ(std::accumulate(values.begin(), values.end(), 0), 2000);
+
+    int untouched = 0;
+    parallel_for(dispatcher, 5, 5, [&untouched](size_t) { untouched++; });
+    EXPECT_EQ(untouched, 0);
+}
+
+TEST(ParallelTest, reduce) {
+    TaskDispatcher dispatcher(4);
+    auto sum = parallel_reduce(
+        dispatcher, 1, 100001, uint64_t{0}, [](uint64_t sum, size_t i) { return sum + i; },
+        [](uint64_t a, uint64_t b) { return a + b; });
+    EXPECT_EQ(sum, 100000ull * 100001 / 2);
+
+    auto max = parallel_reduce(
+        dispatcher, 0, 1000, size_t{0}, [](size_t max, size_t i) { return std::max(max, (i * 7919) % 1000); },
+        [](size_t a, size_t b) { return std::max(a, b); });
+    EXPECT_EQ(max, 999u);
+}
+
+TEST(ParallelTest, callerTakesPart) {
+    TaskDispatcher dispatcher(1);
+    std::promise<void> release;
+    std::promise<void> worker_busy;
+    auto released = release.get_future().share();
+    dispatcher.schedule(TaskPriority::Normal, [&worker_busy, released]() {
+        worker_busy.set_value();
+        released.wait();
+    });
+    worker_busy.get_future().get();
+
+    // the only worker is blocked, so the loop completes on the calling thread alone
+    auto caller = std::this_thread::get_id();
+    std::atomic<int> on_caller{0};
+    parallel_for(dispatcher, 0, 100,
+                 [&on_caller, caller](size_t) { on_caller += std::this_thread::get_id() == caller; });
+    EXPECT_EQ(on_caller.load(), 100);
+    release.set_value();
+}
+
+TEST(ParallelTest, nestedLoops) {
+    TaskDispatcher dispatcher(2);
+    std::atomic<int> visits{0};
+    parallel_for(dispatcher, 0, 16, [&](size_t) { parallel_for(dispatcher, 0, 64, [&visits](size_t) { visits++; }); });
+    EXPECT_EQ(visits.load(), 16 * 64);
+}
+
+TEST(ParallelTest, errors) {
+    TaskDispatcher dispatcher(2);
+    std::atomic<int> visits{0};
+    EXPECT_THROW(parallel_for(dispatcher, 0, 100000,
+                              [&visits](size_t i) {
+                                  if (i == 10) {
+                                      throw std::runtime_error("boom");
+                                  }
+                                  visits++;
+                              }),
+                 std::runtime_error);
+    EXPECT_LT(visits.load(), 100000);
+
+    EXPECT_THROW(parallel_for(dispatcher, 2, 1, [](size_t) {}), std::invalid_argument);
+    EXPECT_THROW(parallel_for(dispatcher, 0, 10, [](size_t) {}, TaskPriority::Normal, 0), std::invalid_argument);
+    EXPECT_THROW(parallel_for(dispatcher, 0, 10, [](size_t) {}, TaskPriority::Low), std::invalid_argument);
+}
@@ -1,8 +1,11 @@
 #include <gtest/gtest.h>
 
 #include "queue/bounded_queue.hpp"
+#include <chrono>
+#include <thread>
 
 using namespace dispatcher::queue;
+using dispatcher::Task;
 
 TEST(BoundedQueueTest, constructor) {
     EXPECT_THROW(BoundedQueue(-1), std::invalid_argument);
@@ -96,4 +99,48 @@ TEST(BoundedQueueTest, shutdown) {
     EXPECT_TRUE(push_unblocked.load());
 }
 
-// здесь ваш код
\ No newline at end of file
+// здесь ваш код
+TEST(BoundedQueueTest, tryPushBulkPartial) {
+    BoundedQueue queue(3);
+    queue.push([]() {});
+
+    int executed = 0;
+    std::vector<Task> tasks;
+    for (int i = 0; i < 4; ++i) {
+        tasks.emplace_back([&executed]() { executed++; });
+    }
+
+    EXPECT_EQ(queue.try_push_bulk(tasks), 2u);
+    EXPECT_FALSE(tasks[0]);
+    EXPECT_FALSE(tasks[1]);
+    EXPECT_TRUE(tasks[2]);  // rejected tasks stay with the caller
+    EXPECT_TRUE(tasks[3]);
+    EXPECT_EQ(queue.try_push_bulk(std::span<Task>(tasks).subspan(2)), 0u);
+
+    int popped_count = 0;
+    while (auto task = queue.try_pop()) {
+        (*task)();
+        popped_count++;
+    }
+    EXPECT_EQ(popped_count, 3);
+    EXPECT_EQ(executed, 2);
+}
+
+TEST(BoundedQueueTest, pushUntilTimesOut) {
+    BoundedQueue queue(1);
+    queue.push([]() {});
+
+    Task task([]() {});
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_FALSE(queue.push_until(task, start + std::chrono::milliseconds(20)));
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+    EXPECT_TRUE(task);  // a task that timed out stays with the caller
+
+    std::thread consumer([&queue]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        queue.try_pop();
+    });
+    EXPECT_TRUE(queue.push_until(task, std::chrono::steady_clock::now() + std::chrono::seconds(5)));
+    EXPECT_FALSE(task);
+    consumer.join();
+}
@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+
+#include "metrics.hpp"
+#include "queue/deadline_queue.hpp"
+#include "queue/priority_queue.hpp"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace dispatcher::queue;
+using dispatcher::Task;
+using dispatcher::TaskPriority;
+using dispatcher::metrics::now_ns;
+
+namespace {
+
+constexpr int64_t kSecond = 1'000'000'000;
+
+}  // namespace
+
+TEST(DeadlineQueueTest, earliestDeadlineFirst) {
+    DeadlineQueue queue;
+    std::vector<int> seen;
+    std::vector<int64_t> offsets = {5, 1, 4, 1, 3, 9, 2, 6};
+    int64_t base = now_ns() + 60 * kSecond;
+    for (size_t i = 0; i < offsets.size(); ++i) {
+        queue.push([&seen, i]() { seen.push_back(static_cast<int>(i)); }, base + offsets[i]);
+    }
+    // no deadline, after everything else
+    queue.push([&seen]() { seen.push_back(-1); });
+
+    while (auto task = queue.try_pop()) {
+        (*task)();
+    }
+    // equal deadlines keep their push order
+    EXPECT_EQ(seen, (std::vector<int>{1, 3, 6, 4, 2, 0, 7, 5, -1}));
+    EXPECT_EQ(queue.take_expired(), 0u);
+}
+
+TEST(DeadlineQueueTest, manyTasksInOrder) {
+    DeadlineQueue queue;
+    std::mt19937 random(42);
+    int64_t base = now_ns() + 60 * kSecond;
+    for (int i = 0; i < 10000; ++i) {
+        queue.push([]() {}, base + static_cast<int64_t>(random() % 1000));
+    }
+    // pushed with deadlines of their own, checked through the order they come back in
+    std::vector<int64_t> deadlines;
+    for (int i = 0; i < 10000; ++i) {
+        int64_t deadline = base + static_cast<int64_t>(random() % 100000);
+        queue.push([&deadlines, deadline]() { deadlines.push_back(deadline); }, deadline + 1000);
+    }
+    size_t popped = 0;
+    while (auto task = queue.try_pop()) {
+        (*task)();
+        ++popped;
+    }
+    EXPECT_EQ(popped, 20000u);
+    EXPECT_TRUE(std::is_sorted(deadlines.begin(), deadlines.end()));
+}
+
+TEST(DeadlineQueueTest, expiredTasksAreDiscarded) {
+    DeadlineQueue queue;
+    int runs = 0;
+    auto task = [&runs]() { ++runs; };
+    queue.push(task, now_ns() - kSecond);
+    queue.push(task, now_ns() + 200'000'000);
+    queue.push(task, now_ns() + 60 * kSecond);
+    queue.push(task);
+
+    auto first = queue.try_pop();
+    ASSERT_TRUE(first.has_value());
+    EXPECT_EQ(queue.take_expired(), 1u);
+    EXPECT_EQ(queue.take_expired(), 0u);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    // the rest: the one with a distant deadline and the one with none
+    int left = 0;
+    while (auto next = queue.try_pop()) {
+        (*next)();
+        ++left;
+    }
+    EXPECT_EQ(left, 2);
+    EXPECT_EQ(runs, 2);
+    EXPECT_EQ(queue.take_expired(), 0u);
+}
+
+TEST(DeadlineQueueTest, priorityQueueLane) {
+    using namespace std::chrono_literals;
+    EXPECT_THROW(PriorityQueue({{TaskPriority::High, {true, 10, QueueType::Deadline}}}), std::invalid_argument);
+
+    PriorityQueue pq({{TaskPriority::High, {true, 10}}, {TaskPriority::Normal, {false, {}, QueueType::Deadline}}});
+    EXPECT_THROW(pq.push_deadline(TaskPriority::High, []() {}, std::chrono::steady_clock::now() + 1s),
+                 std::invalid_argument);
+
+    std::vector<int> seen;
+    auto now = std::chrono::steady_clock::now();
+    pq.push_deadline(TaskPriority::Normal, [&seen]() { seen.push_back(2); }, now + 20s);
+    pq.push_deadline(TaskPriority::Normal, [&seen]() { seen.push_back(0); }, now - 1s);
+    pq.push_deadline(TaskPriority::Normal, [&seen]() { seen.push_back(1); }, now + 10s);
+    pq.push(TaskPriority::Normal, [&seen]() { seen.push_back(3); });
+    EXPECT_EQ(pq.depth(), 4u);
+
+    while (auto task = pq.try_pop()) {
+        (*task)();
+    }
+    EXPECT_EQ(seen, (std::vector<int>{1, 2, 3}));
+    EXPECT_EQ(pq.depth(), 0u);
+    EXPECT_EQ(pq.pending_levels(), 0u);
+    if (dispatcher::metrics::kEnabled) {
+        auto snapshot = pq.metrics_snapshot();
+        EXPECT_EQ(snapshot.lanes[1].enqueued, 4u);
+        EXPECT_EQ(snapshot.lanes[1].dequeued, 3u);
+        EXPECT_EQ(snapshot.lanes[1].expired, 1u);
+    }
+}
@@ -4,6 +4,7 @@
 #include <atomic>
 #include <chrono>
 #include <future>
+#include <string>
 #include <thread>
 #include <vector>
 
@@ -31,6 +32,14 @@ TEST_F(PriorityQueueTest, invalidConstructor) {
     invalid_config = {{TaskPriority::High, {true, -1}}};
     EXPECT_THROW(PriorityQueue pq(invalid_config), std::invalid_argument);
 
+    invalid_config = {{TaskPriority::Normal, {false, {}, QueueType::LockFree}}};
+    invalid_config[TaskPriority::Normal].segment_size = 0;
+    EXPECT_THROW(PriorityQueue pq(invalid_config), std::invalid_argument);
+
+    std::unordered_map<TaskPriority, QueueOptions> lock_free_unbounded = {
+        {TaskPriority::Normal, {false, {}, QueueType::LockFree}}};
+    EXPECT_NO_THROW(PriorityQueue pq(lock_free_unbounded));
+
     EXPECT_NO_THROW(PriorityQueue pq(config_));
 }
 
@@ -56,7 +65,7 @@ TEST_F(PriorityQueueTest, order) {
         execution_order.push_back(2);
     });
 
-    std::vector<std::function<void()>> tasks;
+    std::vector<Task> tasks;
     for (int i = 0; i < 4; ++i) {
         auto task = pq.pop();
         ASSERT_TRUE(task.has_value());
@@ -160,4 +169,409 @@ TEST_F(PriorityQueueTest, pushAndShutdown) {
     EXPECT_EQ(executed_count.load(), 2);
 
     EXPECT_FALSE(pq.pop().has_value());
-}
\ No newline at end of file
+}
+
+TEST_F(PriorityQueueTest, lockFreeHighLane) {
+    config_[TaskPriority::High] = {true, 100, QueueType::LockFree};
+    PriorityQueue pq(config_);
+
+    std::vector<int> execution_order;
+    pq.push(TaskPriority::Normal, [&execution_order]() { execution_order.push_back(2); });
+    pq.push(TaskPriority::High, [&execution_order]() { execution_order.push_back(1); });
+
+    for (int i = 0; i < 2; ++i) {
+        auto task = pq.pop();
+        ASSERT_TRUE(task.has_value());
+        (*task)();
+    }
+
+    ASSERT_EQ(execution_order.size(), 2u);
+    EXPECT_EQ(execution_order[0], 1);
+    EXPECT_EQ(execution_order[1], 2);
+}
+
+TEST_F(PriorityQueueTest, concurrentPop) {
+    PriorityQueue pq(config_);
+    const int num_consumers = 4;
+    const int num_producers = 4;
+    const int tasks_per_producer = 5000;
+    std::atomic<int> executed{0};
+
+    // consumers start on empty lanes and park, so every push must wake someone
+    std::vector<std::thread> consumers;
+    for (int i = 0; i < num_consumers; ++i) {
+        consumers.emplace_back([&pq]() {
+            while (auto task = pq.pop()) {
+                (*task)();
+            }
+        });
+    }
+
+    std::vector<std::thread> producers;
+    for (int i = 0; i < num_producers; ++i) {
+        producers.emplace_back([&pq, &executed, i]() {
+            auto priority = i % 2 == 0 ? TaskPriority::High : TaskPriority::Normal;
+            for (int j = 0; j < tasks_per_producer; ++j) {
+                pq.push(priority, [&executed]() { executed++; });
+            }
+        });
+    }
+    for (auto &producer : producers) {
+        producer.join();
+    }
+
+    while (executed.load() < num_producers * tasks_per_producer) {
+        std::this_thread::yield();
+    }
+    pq.shutdown();
+    for (auto &consumer : consumers) {
+        consumer.join();
+    }
+
+    EXPECT_EQ(executed.load(), num_producers * tasks_per_producer);
+}
+
+
+TEST_F(PriorityQueueTest, pushBulkBlocksOnFullLane) {
+    config_[TaskPriority::High] = {true, 4};
+    PriorityQueue pq(config_);
+    const int num_tasks = 50;
+    std::atomic<int> executed{0};
+
+    std::thread consumer([&pq]() {
+        while (auto task = pq.pop()) {
+            (*task)();
+        }
+    });
+
+    std::vector<Task> tasks;
+    for (int i = 0; i < num_tasks; ++i) {
+        tasks.emplace_back([&executed]() { executed++; });
+    }
+    // the batch is ten times the lane capacity, so it only completes if partial batches are visible to pop
+    pq.push_bulk(TaskPriority::High, tasks);
+
+    while (executed.load() < num_tasks) {
+        std::this_thread::yield();
+    }
+    pq.shutdown();
+    consumer.join();
+    EXPECT_EQ(executed.load(), num_tasks);
+}
+
+TEST_F(PriorityQueueTest, tryPushBulkReportsAccepted) {
+    config_[TaskPriority::High] = {true, 4, QueueType::LockFree};
+    PriorityQueue pq(config_);
+
+    std::vector<Task> tasks;
+    for (int i = 0; i < 6; ++i) {
+        tasks.emplace_back([]() {});
+    }
+    EXPECT_EQ(pq.try_push_bulk(TaskPriority::High, tasks), 4u);
+    EXPECT_EQ(pq.try_push_bulk(TaskPriority::Normal, std::span<Task>(tasks).subspan(4)), 2u);
+
+    int popped_count = 0;
+    pq.shutdown();
+    while (auto task = pq.pop()) {
+        popped_count++;
+    }
+    EXPECT_EQ(popped_count, 6);
+}
+
+TEST_F(PriorityQueueTest, manyLevels) {
+    const std::vector<TaskPriority> levels = {
+        TaskPriority::Critical, TaskPriority::High,       TaskPriority::Interactive, TaskPriority::Normal,
+        TaskPriority::Low,      TaskPriority::Batch,      TaskPriority::Background,  TaskPriority::Scavenger,
+        TaskPriority{20},       TaskPriority{kTaskPriorityCount - 1}};
+    std::unordered_map<TaskPriority, QueueOptions> config;
+    for (auto level : levels) {
+        config[level] = {false, {}};
+    }
+    config[TaskPriority::Interactive] = {true, 8, QueueType::LockFree};
+    PriorityQueue pq(config);
+
+    std::vector<int> execution_order;
+    // pushed lowest level first, popped highest level first
+    for (size_t i = levels.size(); i-- > 0;) {
+        pq.push(levels[i], [&execution_order, i]() { execution_order.push_back(static_cast<int>(i)); });
+    }
+    for (size_t i = 0; i < levels.size(); ++i) {
+        auto task = pq.pop();
+        ASSERT_TRUE(task.has_value());
+        (*task)();
+    }
+
+    ASSERT_EQ(execution_order.size(), levels.size());
+    for (size_t i = 0; i < levels.size(); ++i) {
+        EXPECT_EQ(execution_order[i], static_cast<int>(i));
+    }
+    EXPECT_EQ(pq.pending_levels(), 0u);
+    EXPECT_FALSE(pq.try_pop(TaskPriority{21}).has_value());
+    EXPECT_THROW(pq.push(TaskPriority{21}, []() {}), std::invalid_argument);
+
+    config[TaskPriority{kTaskPriorityCount}] = {false, {}};
+    EXPECT_THROW(PriorityQueue invalid(config), std::invalid_argument);
+}
+
+TEST_F(PriorityQueueTest, concurrentPopManyLevels) {
+    std::unordered_map<TaskPriority, QueueOptions> config;
+    const size_t num_levels = 16;
+    for (size_t level = 0; level < num_levels; ++level) {
+        config[TaskPriority(level)] = {false, {}};
+    }
+    PriorityQueue pq(config);
+    const int num_consumers = 4;
+    const int tasks_per_level = 2000;
+    std::atomic<int> executed{0};
+
+    std::vector<std::thread> consumers;
+    for (int i = 0; i < num_consumers; ++i) {
+        consumers.emplace_back([&pq]() {
+            while (auto task = pq.pop()) {
+                (*task)();
+            }
+        });
+    }
+
+    std::vector<std::thread> producers;
+    for (size_t level = 0; level < num_levels; ++level) {
+        producers.emplace_back([&pq, &executed, level]() {
+            for (int j = 0; j < tasks_per_level; ++j) {
+                pq.push(TaskPriority(level), [&executed]() { executed++; });
+            }
+        });
+    }
+    for (auto &producer : producers) {
+        producer.join();
+    }
+
+    while (executed.load() < static_cast<int>(num_levels) * tasks_per_level) {
+        std::this_thread::yield();
+    }
+    pq.shutdown();
+    for (auto &consumer : consumers) {
+        consumer.join();
+    }
+
+    EXPECT_EQ(executed.load(), static_cast<int>(num_levels) * tasks_per_level);
+    EXPECT_EQ(pq.pending_levels(), 0u);
+}
+
+TEST_F(PriorityQueueTest, weightedRoundRobin) {
+    config_[TaskPriority::High] = {true, 100, QueueType::Mutex, 3};
+    PriorityQueue pq(config_, {.policy = SchedulingPolicy::WeightedRoundRobin});
+
+    std::string order;
+    for (int i = 0; i < 9; ++i) {
+        pq.push(TaskPriority::High, [&order]() { order += 'H'; });
+    }
+    for (int i = 0; i < 5; ++i) {
+        pq.push(TaskPriority::Normal, [&order]() { order += 'N'; });
+    }
+    while (auto task = pq.try_pop()) {
+        (*task)();
+    }
+
+    EXPECT_EQ(order, "HHHNHHHNHHHNNN");
+
+    config_[TaskPriority::Normal].weight = 0;
+    EXPECT_THROW(PriorityQueue invalid(config_), std::invalid_argument);
+}
+
+TEST_F(PriorityQueueTest, agingPromotesStarvedLane) {
+    using namespace std::chrono_literals;
+    PriorityQueue pq(config_, {.aging_threshold = 20ms});
+
+    std::string order;
+    pq.push(TaskPriority::Normal, [&order]() { order += 'N'; });
+    pq.push(TaskPriority::High, [&order]() { order += 'H'; });
+    (*pq.pop())();
+    EXPECT_EQ(order, "H");
+
+    std::this_thread::sleep_for(30ms);
+    pq.push(TaskPriority::High, [&order]() { order += 'H'; });
+    // Normal has waited past the threshold, so it overtakes the waiting High task
+    (*pq.pop())();
+    (*pq.pop())();
+    EXPECT_EQ(order, "HNH");
+
+    EXPECT_THROW(PriorityQueue invalid(config_, {.aging_threshold = 0ms}), std::invalid_argument);
+}
+
+TEST_F(PriorityQueueTest, overflowReject) {
+    config_[TaskPriority::High] = {true, 2, QueueType::Mutex, 1, OverflowPolicy::Reject};
+    PriorityQueue pq(config_);
+
+    int executed = 0;
+    for (int i = 0; i < 5; ++i) {
+        // a Reject lane never blocks, the extra tasks are dropped
+        pq.push(TaskPriority::High, [&executed]() { executed++; });
+    }
+    Task task([&executed]() { executed++; });
+    EXPECT_FALSE(pq.try_push(TaskPriority::High, task));
+    EXPECT_TRUE(task);
+
+    pq.shutdown();
+    while (auto popped = pq.pop()) {
+        (*popped)();
+    }
+    EXPECT_EQ(executed, 2);
+    if (metrics::kEnabled) {
+        auto snapshot = pq.metrics_snapshot();
+        EXPECT_EQ(snapshot.lanes[0].enqueued, 2u);
+        EXPECT_EQ(snapshot.lanes[0].rejected, 4u);
+    }
+}
+
+TEST_F(PriorityQueueTest, overflowDropOldest) {
+    config_[TaskPriority::High] = {true, 3, QueueType::LockFree, 1, OverflowPolicy::DropOldest};
+    PriorityQueue pq(config_);
+
+    std::vector<int> order;
+    for (int i = 0; i < 5; ++i) {
+        pq.push(TaskPriority::High, [&order, i]() { order.push_back(i); });
+    }
+    std::vector<Task> tasks;
+    tasks.emplace_back([&order]() { order.push_back(5); });
+    EXPECT_EQ(pq.try_push_bulk(TaskPriority::High, tasks), 1u);
+
+    pq.shutdown();
+    while (auto popped = pq.pop()) {
+        (*popped)();
+    }
+    EXPECT_EQ(order, (std::vector<int>{3, 4, 5}));
+    if (metrics::kEnabled) {
+        auto snapshot = pq.metrics_snapshot();
+        EXPECT_EQ(snapshot.lanes[0].enqueued, 6u);
+        EXPECT_EQ(snapshot.lanes[0].dropped, 3u);
+        EXPECT_EQ(snapshot.lanes[0].rejected, 0u);
+    }
+}
+
+TEST_F(PriorityQueueTest, overflowDivert) {
+    config_[TaskPriority::Critical] = {true, 1, QueueType::Mutex, 1, OverflowPolicy::Divert};
+    config_[TaskPriority::High] = {true, 1, QueueType::Mutex, 1, OverflowPolicy::Divert, TaskPriority::Normal};
+    PriorityQueue pq(config_);
+
+    std::vector<int> order;
+    for (int i = 0; i < 3; ++i) {
+        // Critical overflows into High, the next configured lane, and High into Normal
+        pq.push(TaskPriority::Critical, [&order, i]() { order.push_back(i); });
+    }
+
+    pq.shutdown();
+    while (auto popped = pq.pop()) {
+        (*popped)();
+    }
+    EXPECT_EQ(order, (std::vector<int>{0, 1, 2}));
+
+    config_[TaskPriority::Normal] = {true, 1, QueueType::Mutex, 1, OverflowPolicy::Divert};  // nothing below
+    EXPECT_THROW(PriorityQueue invalid(config_), std::invalid_argument);
+    config_[TaskPriority::Normal] = {true, 1, QueueType::Mutex, 1, OverflowPolicy::Divert, TaskPriority::High};
+    EXPECT_THROW(PriorityQueue invalid(config_), std::invalid_argument);
+}
+
+TEST_F(PriorityQueueTest, pushUntilTimesOutOnBlockLane) {
+    config_[TaskPriority::High] = {true, 1};
+    PriorityQueue pq(config_);
+    pq.push(TaskPriority::High, []() {});
+
+    Task task([]() {});
+    EXPECT_FALSE(pq.try_push(TaskPriority::High, task));
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_FALSE(pq.push_until(TaskPriority::High, task, start + std::chrono::milliseconds(20)));
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+    EXPECT_TRUE(task);
+
+    std::thread consumer([&pq]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        pq.try_pop();
+    });
+    EXPECT_TRUE(pq.push_until(TaskPriority::High, task, std::chrono::steady_clock::now() + std::chrono::seconds(5)));
+    consumer.join();
+    EXPECT_EQ(pq.pending_levels(), LevelMask::Bits{1} << static_cast<size_t>(TaskPriority::High));
+}
+
+TEST_F(PriorityQueueTest, popUntilTimesOut) {
+    PriorityQueue pq(config_);
+
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_FALSE(pq.pop_until(start + std::chrono::milliseconds(20)).has_value());
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+
+    std::thread producer([&pq]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        pq.push(TaskPriority::Normal, []() {});
+    });
+    EXPECT_TRUE(pq.pop_until(std::chrono::steady_clock::now() + std::chrono::seconds(5)).has_value());
+    producer.join();
+    EXPECT_EQ(pq.depth(), 0u);
+}
+
+TEST_F(PriorityQueueTest, spinningConsumer) {
+    for (auto idle : {IdleStrategy::balanced(), IdleStrategy::low_latency(), IdleStrategy{0, 4}}) {
+        PriorityQueue pq(config_, {.idle = idle});
+        constexpr int kTasks = 1000;
+        std::atomic<int> executed{0};
+        std::thread consumer([&pq, &executed]() {
+            while (auto task = pq.pop()) {
+                (*task)();
+            }
+        });
+        for (int i = 0; i < kTasks; ++i) {
+            pq.push(i % 2 ? TaskPriority::High : TaskPriority::Normal, [&executed]() { executed++; });
+            if (i % 100 == 0) {
+                // lets the consumer run out of work and go through spinning, yielding and parking
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        while (pq.depth() > 0) {
+            std::this_thread::yield();
+        }
+        pq.shutdown();
+        consumer.join();
+        EXPECT_EQ(executed.load(), kTasks);
+    }
+}
+
+TEST_F(PriorityQueueTest, rateLimit) {
+    using namespace std::chrono_literals;
+    auto config = config_;
+    config[TaskPriority::Normal].rate_limit = RateLimit{0};
+    EXPECT_THROW(PriorityQueue{config}, std::invalid_argument);
+    config[TaskPriority::Normal].rate_limit = RateLimit{100, 0};
+    EXPECT_THROW(PriorityQueue{config}, std::invalid_argument);
+
+    config[TaskPriority::Normal].rate_limit = RateLimit{20, 5};
+    PriorityQueue pq(config);
+    EXPECT_TRUE(pq.rate_limited(TaskPriority::Normal));
+    EXPECT_FALSE(pq.rate_limited(TaskPriority::High));
+    EXPECT_EQ(pq.next_refill(), std::chrono::steady_clock::time_point::max());
+
+    for (int i = 0; i < 20; ++i) {
+        pq.push(TaskPriority::Normal, []() {});
+    }
+    // the burst goes through at once, then the lane is skipped
+    int popped = 0;
+    while (pq.try_pop()) {
+        ++popped;
+    }
+    EXPECT_EQ(popped, 5);
+    EXPECT_EQ(pq.pending_levels(), 0u);
+    EXPECT_GT(pq.next_refill(), std::chrono::steady_clock::now());
+    EXPECT_LT(pq.next_refill(), std::chrono::steady_clock::now() + 100ms);
+
+    // other lanes are not held back
+    pq.push(TaskPriority::High, []() {});
+    EXPECT_TRUE(pq.try_pop().has_value());
+    EXPECT_FALSE(pq.try_pop(TaskPriority::Normal).has_value());
+
+    // a sleeping consumer wakes up for the refill: five more tasks at 50ms apart
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 5; ++i) {
+        EXPECT_TRUE(pq.pop_until(std::chrono::steady_clock::now() + 5s).has_value());
+    }
+    EXPECT_GE(std::chrono::steady_clock::now() - start, 200ms);
+    EXPECT_EQ(pq.depth(), 10u);
+    pq.shutdown();
+}
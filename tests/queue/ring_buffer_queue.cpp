@@ -0,0 +1,292 @@
+#include <gtest/gtest.h>
+
+#include "queue/ring_buffer_queue.hpp"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <span>
+#include <vector>
+
+using namespace dispatcher::queue;
+using dispatcher::Task;
+
+TEST(RingBufferQueueTest, constructor) {
+    EXPECT_THROW(RingBufferQueue(-1), std::invalid_argument);
+    EXPECT_THROW(RingBufferQueue(0), std::invalid_argument);
+    EXPECT_NO_THROW(RingBufferQueue(1));
+}
+
+TEST(RingBufferQueueTest, pushPop) {
+    RingBufferQueue queue(2);
+    EXPECT_FALSE(queue.try_pop().has_value());
+
+    bool executed = false;
+    queue.push([&executed]() { executed = true; });
+    auto task = queue.try_pop();
+    ASSERT_TRUE(task.has_value());
+    ASSERT_FALSE(executed);
+    (*task)();
+    EXPECT_TRUE(executed);
+    EXPECT_FALSE(queue.try_pop().has_value());
+}
+
+TEST(RingBufferQueueTest, fifo) {
+    // capacity is not a power of two on purpose, the ring must wrap around several times
+    RingBufferQueue queue(3);
+    std::vector<int> execution_order;
+
+    for (int i = 0; i < 10; ++i) {
+        queue.push([i, &execution_order]() { execution_order.push_back(i); });
+        auto task = queue.try_pop();
+        ASSERT_TRUE(task.has_value());
+        (*task)();
+    }
+
+    ASSERT_EQ(execution_order.size(), 10u);
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ(execution_order[i], i);
+    }
+}
+
+TEST(RingBufferQueueTest, capacityLimit) {
+    const int capacity = 3;
+    RingBufferQueue queue(capacity);
+
+    for (int i = 0; i < capacity; ++i) {
+        queue.push([]() {});
+    }
+
+    std::atomic<bool> push_completed{false};
+    std::thread producer([&queue, &push_completed]() {
+        queue.push([]() {});  // BLOCKED
+        push_completed = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    ASSERT_FALSE(push_completed.load());
+
+    auto task = queue.try_pop();
+    EXPECT_TRUE(task.has_value());
+
+    producer.join();
+    EXPECT_TRUE(push_completed.load());
+
+    int popped_count = 0;
+    while (queue.try_pop()) {
+        popped_count++;
+    }
+    EXPECT_EQ(popped_count, capacity);
+}
+
+TEST(RingBufferQueueTest, shutdown) {
+    std::atomic<bool> push_unblocked{false};
+    std::atomic<bool> push_started{false};
+    std::thread blocked_producer;
+
+    {
+        RingBufferQueue queue(2);
+
+        queue.push([]() {});
+        queue.push([]() {});
+
+        blocked_producer = std::thread([&queue, &push_unblocked, &push_started]() {
+            push_started = true;
+            queue.push([]() {});
+            push_unblocked = true;
+        });
+
+        while (!push_started.load()) {
+            std::this_thread::yield();
+        }
+        ASSERT_FALSE(push_unblocked.load());
+    }
+
+    blocked_producer.join();
+    EXPECT_TRUE(push_unblocked.load());
+}
+
+TEST(RingBufferQueueTest, stressManyProducersManyConsumers) {
+    const int num_producers = 8;
+    const int num_consumers = 4;
+    const int tasks_per_producer = 20000;
+    RingBufferQueue queue(16);  // small capacity keeps producers blocking on a full ring
+
+    std::atomic<long long> sum{0};
+    std::atomic<int> executed{0};
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < num_producers; ++p) {
+        producers.emplace_back([&queue, &sum]() {
+            for (int i = 0; i < tasks_per_producer; ++i) {
+                queue.push([&sum, i]() { sum += i; });
+            }
+        });
+    }
+
+    std::vector<std::thread> consumers;
+    for (int c = 0; c < num_consumers; ++c) {
+        consumers.emplace_back([&queue, &executed]() {
+            while (executed.load() < num_producers * tasks_per_producer) {
+                if (auto task = queue.try_pop()) {
+                    (*task)();
+                    executed++;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    for (auto &producer : producers) {
+        producer.join();
+    }
+    for (auto &consumer : consumers) {
+        consumer.join();
+    }
+
+    const long long expected = 1LL * num_producers * tasks_per_producer * (tasks_per_producer - 1) / 2;
+    EXPECT_EQ(executed.load(), num_producers * tasks_per_producer);
+    EXPECT_EQ(sum.load(), expected);
+    EXPECT_FALSE(queue.try_pop().has_value());
+}
+
+TEST(RingBufferQueueTest, stressPerProducerFifo) {
+    const int num_producers = 4;
+    const int tasks_per_producer = 20000;
+    RingBufferQueue queue(64);
+
+    // a single consumer must observe every producer's tasks in the order they were pushed
+    std::vector<int> last_seen(num_producers, -1);
+    bool order_violated = false;
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < num_producers; ++p) {
+        producers.emplace_back([&queue, &last_seen, &order_violated, p]() {
+            for (int i = 0; i < tasks_per_producer; ++i) {
+                queue.push([&last_seen, &order_violated, p, i]() {
+                    if (last_seen[p] + 1 != i) {
+                        order_violated = true;
+                    }
+                    last_seen[p] = i;
+                });
+            }
+        });
+    }
+
+    int executed = 0;
+    while (executed < num_producers * tasks_per_producer) {
+        if (auto task = queue.try_pop()) {
+            (*task)();
+            executed++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    for (auto &producer : producers) {
+        producer.join();
+    }
+
+    EXPECT_FALSE(order_violated);
+    for (int p = 0; p < num_producers; ++p) {
+        EXPECT_EQ(last_seen[p], tasks_per_producer - 1);
+    }
+}
+
+TEST(RingBufferQueueTest, tryPushBulkWrapsAround) {
+    RingBufferQueue queue(5);
+    std::vector<int> execution_order;
+
+    // move the ring positions so the batch has to wrap
+    for (int i = 0; i < 3; ++i) {
+        queue.push([]() {});
+        ASSERT_TRUE(queue.try_pop().has_value());
+    }
+
+    std::vector<Task> tasks;
+    for (int i = 0; i < 7; ++i) {
+        tasks.emplace_back([i, &execution_order]() { execution_order.push_back(i); });
+    }
+    EXPECT_EQ(queue.try_push_bulk(tasks), 5u);
+    EXPECT_EQ(queue.try_push_bulk(std::span<Task>(tasks).subspan(5)), 0u);
+
+    for (int i = 0; i < 2; ++i) {
+        auto task = queue.try_pop();
+        ASSERT_TRUE(task.has_value());
+        (*task)();
+    }
+    EXPECT_EQ(queue.try_push_bulk(std::span<Task>(tasks).subspan(5)), 2u);
+
+    while (auto task = queue.try_pop()) {
+        (*task)();
+    }
+    ASSERT_EQ(execution_order.size(), 7u);
+    for (int i = 0; i < 7; ++i) {
+        EXPECT_EQ(execution_order[i], i);
+    }
+}
+
+TEST(RingBufferQueueTest, stressBulkProducers) {
+    const int num_producers = 4;
+    const int batches_per_producer = 2000;
+    const int batch_size = 7;
+    RingBufferQueue queue(32);
+    std::atomic<int> executed{0};
+    const int total = num_producers * batches_per_producer * batch_size;
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < num_producers; ++p) {
+        producers.emplace_back([&queue, &executed]() {
+            for (int b = 0; b < batches_per_producer; ++b) {
+                std::vector<Task> tasks;
+                for (int i = 0; i < batch_size; ++i) {
+                    tasks.emplace_back([&executed]() { executed++; });
+                }
+                std::span<Task> rest(tasks);
+                while (!rest.empty()) {
+                    rest = rest.subspan(queue.try_push_bulk(rest));
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    std::vector<std::thread> consumers;
+    for (int c = 0; c < 2; ++c) {
+        consumers.emplace_back([&queue, &executed, total]() {
+            while (executed.load() < total) {
+                if (auto task = queue.try_pop()) {
+                    (*task)();
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    for (auto &producer : producers) {
+        producer.join();
+    }
+    for (auto &consumer : consumers) {
+        consumer.join();
+    }
+    EXPECT_EQ(executed.load(), total);
+}
+
+TEST(RingBufferQueueTest, pushUntilWaitsForSlot) {
+    RingBufferQueue queue(2);
+    queue.push([]() {});
+    queue.push([]() {});
+
+    Task task([]() {});
+    EXPECT_FALSE(queue.push_until(task, std::chrono::steady_clock::now() + std::chrono::milliseconds(10)));
+    EXPECT_TRUE(task);
+
+    std::thread consumer([&queue]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        queue.try_pop();
+    });
+    EXPECT_TRUE(queue.push_until(task, std::chrono::steady_clock::now() + std::chrono::seconds(5)));
+    EXPECT_FALSE(task);
+    consumer.join();
+}
@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+
+#include "queue/segmented_queue.hpp"
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace dispatcher::queue;
+using dispatcher::Task;
+
+TEST(SegmentedQueueTest, constructor) {
+    EXPECT_THROW(SegmentedQueue(0), std::invalid_argument);
+    EXPECT_THROW(SegmentedQueue(4, -1), std::invalid_argument);
+    EXPECT_NO_THROW(SegmentedQueue(1, 0));
+}
+
+TEST(SegmentedQueueTest, fifoAcrossSegments) {
+    SegmentedQueue queue(3);
+    std::vector<int> execution_order;
+    EXPECT_FALSE(queue.try_pop().has_value());
+
+    for (int i = 0; i < 10; ++i) {
+        queue.push([i, &execution_order]() { execution_order.push_back(i); });
+    }
+    std::vector<Task> batch;
+    for (int i = 10; i < 20; ++i) {
+        batch.emplace_back([i, &execution_order]() { execution_order.push_back(i); });
+    }
+    EXPECT_EQ(queue.try_push_bulk(batch), batch.size());
+    Task last([&execution_order]() { execution_order.push_back(20); });
+    EXPECT_TRUE(queue.push_until(last, std::chrono::steady_clock::now()));
+
+    while (auto task = queue.try_pop()) {
+        (*task)();
+    }
+    ASSERT_EQ(execution_order.size(), 21u);
+    for (int i = 0; i < 21; ++i) {
+        EXPECT_EQ(execution_order[i], i);
+    }
+}
+
+TEST(SegmentedQueueTest, burstMemoryIsReturned) {
+    SegmentedQueue queue(16, 2);
+    auto payload = std::make_shared<int>(0);
+    for (int i = 0; i < 10000; ++i) {
+        queue.push([payload]() {});
+    }
+    EXPECT_GE(queue.allocated_segments(), 10000u / 16);
+
+    while (queue.try_pop()) {
+    }
+    // a few more segments turning over let the retired ones pass their grace period
+    for (int i = 0; i < 16 * 4; ++i) {
+        queue.push([]() {});
+        queue.try_pop();
+    }
+    EXPECT_LE(queue.allocated_segments(), 2u + 4u);
+    EXPECT_EQ(payload.use_count(), 1);
+}
+
+TEST(SegmentedQueueTest, destructorReleasesTasks) {
+    auto payload = std::make_shared<int>(0);
+    {
+        SegmentedQueue queue(4);
+        for (int i = 0; i < 10; ++i) {
+            queue.push([payload]() {});
+        }
+        queue.try_pop();
+    }
+    EXPECT_EQ(payload.use_count(), 1);
+}
+
+TEST(SegmentedQueueTest, stressManyProducersManyConsumers) {
+    const int num_producers = 12;
+    const int num_consumers = 4;
+    const int tasks_per_producer = 20000;
+    SegmentedQueue queue(32, 1);  // small segments keep them turning over
+
+    std::atomic<long long> sum{0};
+    std::atomic<int> executed{0};
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < num_producers; ++p) {
+        producers.emplace_back([&queue, &sum, p]() {
+            for (int i = 0; i < tasks_per_producer; ++i) {
+                if (p % 2 == 0) {
+                    queue.push([&sum, i]() { sum += i; });
+                } else {
+                    // tasks_per_producer is even, so the pairs come out exact
+                    Task batch[2] = {[&sum, i]() { sum += i; }, [&sum, i]() { sum += i + 1; }};
+                    queue.try_push_bulk(batch);
+                    ++i;
+                }
+            }
+        });
+    }
+
+    std::vector<std::thread> consumers;
+    for (int c = 0; c < num_consumers; ++c) {
+        consumers.emplace_back([&queue, &executed]() {
+            while (executed.load() < num_producers * tasks_per_producer) {
+                if (auto task = queue.try_pop()) {
+                    (*task)();
+                    executed++;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    for (auto &producer : producers) {
+        producer.join();
+    }
+    for (auto &consumer : consumers) {
+        consumer.join();
+    }
+
+    const long long expected = 1LL * num_producers * tasks_per_producer * (tasks_per_producer - 1) / 2;
+    EXPECT_EQ(executed.load(), num_producers * tasks_per_producer);
+    EXPECT_EQ(sum.load(), expected);
+    EXPECT_FALSE(queue.try_pop().has_value());
+}
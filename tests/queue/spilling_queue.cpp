@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+
+#include "queue/priority_queue.hpp"
+#include "queue/spilling_queue.hpp"
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace dispatcher::queue;
+using dispatcher::Task;
+using dispatcher::TaskPriority;
+
+namespace {
+
+std::vector<std::byte> encode(int value, size_t padding = 0) {
+    std::vector<std::byte> bytes(sizeof(value) + padding);
+    std::memcpy(bytes.data(), &value, sizeof(value));
+    return bytes;
+}
+
+int decode(std::span<const std::byte> bytes) {
+    int value;
+    std::memcpy(&value, bytes.data(), sizeof(value));
+    return value;
+}
+
+}  // namespace
+
+class SpillingQueueTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        directory_ = std::filesystem::temp_directory_path() /
+                     ("spilling-queue-test-" + std::to_string(std::random_device{}()));
+        std::filesystem::create_directories(directory_);
+        registry_.add(1, [this](std::span<const std::byte> bytes) { seen_.push_back(decode(bytes)); });
+    }
+
+    void TearDown() override { std::filesystem::remove_all(directory_); }
+
+    SpillOptions options(size_t max_depth, size_t segment_bytes = 4096) const {
+        return {directory_, max_depth, size_t{1} << 20, segment_bytes};
+    }
+
+    void drain(SpillingQueue &queue) {
+        while (auto task = queue.try_pop()) {
+            (*task)();
+        }
+    }
+
+    std::filesystem::path directory_;
+    SerialTaskRegistry registry_;
+    std::vector<int> seen_;
+};
+
+TEST_F(SpillingQueueTest, constructor) {
+    EXPECT_THROW(SpillingQueue(options(0), registry_), std::invalid_argument);
+    EXPECT_THROW(SpillingQueue({directory_ / "missing"}, registry_), std::invalid_argument);
+    EXPECT_NO_THROW(SpillingQueue(options(1), registry_));
+}
+
+TEST_F(SpillingQueueTest, spillsPastBudgetAndKeepsOrder) {
+    SpillingQueue queue(options(10, 256), registry_);
+    for (int i = 0; i < 1000; ++i) {
+        SerializedTask task{1, encode(i)};
+        queue.push_serialized(task, 0);
+    }
+    EXPECT_EQ(queue.spilled(), 990u);
+    // segment files are unlinked at once, nothing shows up in the directory
+    EXPECT_TRUE(std::filesystem::is_empty(directory_));
+
+    drain(queue);
+    ASSERT_EQ(seen_.size(), 1000u);
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_EQ(seen_[i], i);
+    }
+    EXPECT_EQ(queue.spilled(), 0u);
+}
+
+TEST_F(SpillingQueueTest, closuresKeepTheirPlace) {
+    SpillingQueue queue(options(2, 128), registry_);
+    for (int i = 0; i < 50; ++i) {
+        if (i % 5 == 0) {
+            queue.push([this, i]() { seen_.push_back(i); });
+        } else {
+            // every fifth payload is bigger than a segment and gets one of its own
+            SerializedTask task{1, encode(i, i % 5 == 3 ? 300 : 0)};
+            queue.push_serialized(task, 0);
+        }
+        if (i == 30) {
+            // a partial drain while spilled tasks are pending
+            for (int j = 0; j < 10; ++j) {
+                (*queue.try_pop())();
+            }
+        }
+    }
+    drain(queue);
+    ASSERT_EQ(seen_.size(), 50u);
+    for (int i = 0; i < 50; ++i) {
+        EXPECT_EQ(seen_[i], i);
+    }
+
+    // once the spill is drained, tasks stay in memory again
+    SerializedTask task{1, encode(50)};
+    queue.push_serialized(task, 0);
+    EXPECT_EQ(queue.spilled(), 0u);
+}
+
+TEST_F(SpillingQueueTest, priorityQueueLane) {
+    std::unordered_map<TaskPriority, QueueOptions> config = {{TaskPriority::High, {true, 10}},
+                                                             {TaskPriority::Normal, {false, {}}}};
+    config[TaskPriority::Normal].spill = options(4);
+    PriorityQueue pq(config);
+    std::vector<int> seen;
+    pq.serial_tasks().add(7, [&seen](std::span<const std::byte> bytes) { seen.push_back(decode(bytes)); });
+
+    for (int i = 0; i < 100; ++i) {
+        pq.push_serialized(TaskPriority::Normal, {7, encode(i)});
+    }
+    pq.push_serialized(TaskPriority::High, {7, encode(-1)});
+    EXPECT_EQ(pq.depth(), 101u);
+    EXPECT_THROW(pq.push_serialized(TaskPriority::Normal, {8, {}}), std::invalid_argument);
+
+    while (auto task = pq.try_pop()) {
+        (*task)();
+    }
+    ASSERT_EQ(seen.size(), 101u);
+    EXPECT_EQ(seen.front(), -1);
+    EXPECT_EQ(seen.back(), 99);
+
+    auto invalid = config;
+    invalid[TaskPriority::High].spill = options(4);
+    EXPECT_THROW(PriorityQueue{invalid}, std::invalid_argument);
+}
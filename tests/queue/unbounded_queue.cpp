@@ -3,6 +3,7 @@
 #include "queue/unbounded_queue.hpp"
 
 using namespace dispatcher::queue;
+using dispatcher::Task;
 
 TEST(UnboundedQueueTest, constructor) { EXPECT_NO_THROW(UnboundedQueue queue); }
 
@@ -73,4 +74,23 @@ TEST(UnboundedQueueTest, ShutdownBehavior) {
         ASSERT_TRUE(push_completed.load());
     }
     // producer.join(); You can't do it here
-}
\ No newline at end of file
+}
+
+TEST(UnboundedQueueTest, tryPushBulk) {
+    UnboundedQueue queue;
+    std::vector<int> execution_order;
+    std::vector<Task> tasks;
+    for (int i = 0; i < 100; ++i) {
+        tasks.emplace_back([i, &execution_order]() { execution_order.push_back(i); });
+    }
+
+    EXPECT_EQ(queue.try_push_bulk(tasks), tasks.size());
+    while (auto task = queue.try_pop()) {
+        (*task)();
+    }
+
+    ASSERT_EQ(execution_order.size(), 100u);
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_EQ(execution_order[i], i);
+    }
+}
@@ -0,0 +1,154 @@
+#include "strands.hpp"
+#include "task_dispatcher.hpp"
+#include <atomic>
+#include <deque>
+#include <future>
+#include <gtest/gtest.h>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace dispatcher;
+
+namespace {
+
+// collects scheduled tasks so that the test decides when and in which order they run
+struct ManualExecutor {
+    std::deque<std::pair<TaskPriority, Task>> queued;
+
+    detail::Executor executor() {
+        return {this, [](void *context, TaskPriority priority, Task task) {
+                    static_cast<ManualExecutor *>(context)->queued.emplace_back(priority, std::move(task));
+                }};
+    }
+
+    void run_all() {
+        while (!queued.empty()) {
+            auto task = std::move(queued.front().second);
+            queued.pop_front();
+            task();
+        }
+    }
+};
+
+}  // namespace
+
+TEST(StrandsTest, oneTaskPerKeyAtATime) {
+    ManualExecutor manual;
+    Strands strands(manual.executor());
+    std::vector<int> order;
+
+    for (int i = 0; i < 3; ++i) {
+        strands.schedule(1, TaskPriority::Normal, [&order, i]() { order.push_back(i); });
+    }
+    strands.schedule(2, TaskPriority::High, [&order]() { order.push_back(100); });
+    // only the head of every key reaches the executor
+    ASSERT_EQ(manual.queued.size(), 2u);
+    EXPECT_EQ(manual.queued.back().first, TaskPriority::High);
+    EXPECT_EQ(strands.active(), 2u);
+
+    manual.run_all();
+    EXPECT_EQ(order, (std::vector<int>{0, 100, 1, 2}));
+    // a key with nothing left is forgotten
+    EXPECT_EQ(strands.active(), 0u);
+}
+
+TEST(StrandsTest, exceptionDoesNotStallKey) {
+    ManualExecutor manual;
+    Strands strands(manual.executor());
+    int executed = 0;
+    strands.schedule(7, TaskPriority::Normal, []() { throw std::runtime_error("boom"); });
+    strands.schedule(7, TaskPriority::Normal, [&executed]() { executed++; });
+
+    auto first = std::move(manual.queued.front().second);
+    manual.queued.pop_front();
+    EXPECT_THROW(first(), std::runtime_error);
+    manual.run_all();
+    EXPECT_EQ(executed, 1);
+    EXPECT_EQ(strands.active(), 0u);
+}
+
+TEST(StrandsTest, keyedDispatcher) {
+    TaskDispatcher dispatcher(4);
+    constexpr int kKeys = 16;
+    constexpr int kTasksPerKey = 500;
+    std::vector<int> last_seen(kKeys, -1);
+    std::vector<std::atomic<int>> running(kKeys);
+    std::atomic<int> violations{0};
+    std::atomic<int> executed{0};
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < 2; ++p) {
+        producers.emplace_back([&, p]() {
+            for (int i = 0; i < kTasksPerKey; ++i) {
+                for (int key = p; key < kKeys; key += 2) {
+                    auto priority = i % 3 == 0 ? TaskPriority::High : TaskPriority::Normal;
+                    dispatcher.schedule_keyed(key, priority, [&, key, i]() {
+                        // plain, unsynchronised access: tasks of a key never overlap
+                        if (running[key]++ != 0 || last_seen[key] + 1 != i) {
+                            violations++;
+                        }
+                        last_seen[key] = i;
+                        running[key]--;
+                        executed++;
+                    });
+                }
+            }
+        });
+    }
+    for (auto &producer : producers) {
+        producer.join();
+    }
+    while (executed.load() < kKeys * kTasksPerKey) {
+        std::this_thread::yield();
+    }
+    EXPECT_EQ(violations.load(), 0);
+
+    std::atomic<int> by_name{0};
+    dispatcher.schedule_keyed(std::string("session-1"), TaskPriority::Normal, [&by_name]() { by_name++; });
+    while (by_name.load() == 0) {
+        std::this_thread::yield();
+    }
+
+    queue::QueueOptions rejecting{true, 10, queue::QueueType::Mutex, 1, queue::OverflowPolicy::Reject};
+    TaskDispatcher lossy(1, {{TaskPriority::High, rejecting}});
+    EXPECT_THROW(lossy.schedule_keyed(1, TaskPriority::High, []() {}), std::invalid_argument);
+    EXPECT_THROW(lossy.schedule_keyed(1, TaskPriority::Low, []() {}), std::invalid_argument);
+    EXPECT_THROW(lossy.schedule_keyed(1, TaskPriority::High, nullptr), std::invalid_argument);
+}
+
+TEST(StrandsTest, fullLaneDoesNotBlockWorker) {
+    using namespace std::chrono_literals;
+    // the only worker must never wait for room in a lane that nobody else drains
+    TaskDispatcher dispatcher(1, {{TaskPriority::High, {true, 1}}});
+    std::promise<void> started;
+    std::promise<void> release;
+    std::vector<int> order;
+    std::mutex order_mutex;
+    auto record = [&order, &order_mutex](int value) {
+        std::lock_guard<std::mutex> lock(order_mutex);
+        order.push_back(value);
+    };
+    std::promise<void> done;
+
+    dispatcher.schedule_keyed(1, TaskPriority::High, [&started, &release, &record]() {
+        started.set_value();
+        release.get_future().wait();
+        record(1);
+    });
+    started.get_future().wait();
+    // takes the single slot of the lane
+    dispatcher.schedule_keyed(2, TaskPriority::High, [&record, &done]() {
+        record(3);
+        done.set_value();
+    });
+    // waits in the strand of key 1 and cannot be queued when the first task finishes
+    dispatcher.schedule_keyed(1, TaskPriority::High, [&record]() { record(2); });
+    release.set_value();
+
+    ASSERT_EQ(done.get_future().wait_for(5s), std::future_status::ready);
+    std::lock_guard<std::mutex> lock(order_mutex);
+    EXPECT_EQ(order, (std::vector<int>{1, 2, 3}));
+}
@@ -0,0 +1,138 @@
+#include "task.hpp"
+#include "allocation_counter.hpp"
+#include "queue/priority_queue.hpp"
+#include "task_dispatcher.hpp"
+#include <array>
+#include <future>
+#include <gtest/gtest.h>
+#include <memory>
+#include <thread>
+
+using namespace dispatcher;
+using namespace queue;
+using test::AllocationCounter;
+
+TEST(TaskTest, emptyAndNull) {
+    Task task;
+    EXPECT_FALSE(task);
+    EXPECT_FALSE(Task(nullptr));
+    EXPECT_FALSE(Task(std::function<void()>()));
+
+    void (*function)() = nullptr;
+    EXPECT_FALSE(Task(function));
+}
+
+TEST(TaskTest, moveOnlyCapture) {
+    auto value = std::make_unique<int>(42);
+    int result = 0;
+
+    Task task([value = std::move(value), &result]() { result = *value; });
+    Task moved = std::move(task);
+    EXPECT_FALSE(task);
+    ASSERT_TRUE(moved);
+    moved();
+    EXPECT_EQ(result, 42);
+}
+
+TEST(TaskTest, destroysCapture) {
+    auto counter = std::make_shared<int>(0);
+    {
+        Task task([counter]() {});
+        EXPECT_EQ(counter.use_count(), 2);
+
+        std::array<char, 512> payload{};
+        Task pooled([counter, payload]() { (void)payload; });
+        EXPECT_EQ(counter.use_count(), 3);
+        pooled = std::move(task);
+        EXPECT_EQ(counter.use_count(), 2);
+    }
+    EXPECT_EQ(counter.use_count(), 1);
+}
+
+TEST(TaskTest, inlineClosureDoesNotAllocate) {
+    int a = 0, b = 0, c = 0;
+    std::promise<void> done;
+
+    AllocationCounter counter;
+    for (int i = 0; i < 1000; ++i) {
+        Task task([&a, &b, &c, &done, i]() { a += i + b + c; });
+        Task moved = std::move(task);
+        moved();
+    }
+    EXPECT_EQ(counter.count(), 0u);
+}
+
+TEST(TaskTest, oversizedClosureIsPooled) {
+    std::array<char, 200> payload{};
+    auto make_task = [&payload]() { return Task([payload]() { (void)payload; }); };
+
+    // the first closure of a size class fills this thread's cache
+    make_task()();
+
+    AllocationCounter counter;
+    for (int i = 0; i < 1000; ++i) {
+        make_task()();
+    }
+    EXPECT_EQ(counter.count(), 0u);
+}
+
+TEST(TaskTest, oversizedClosureRecycledAcrossThreads) {
+    std::array<char, 200> payload{};
+    const int batches = 20;
+    const int batch_size = 100;
+
+    // warm up: tasks built here and destroyed on another thread
+    RingBufferQueue queue(batch_size);
+    auto drain = [&queue]() {
+        std::thread consumer([&queue]() {
+            while (auto task = queue.try_pop()) {
+                (*task)();
+            }
+        });
+        consumer.join();
+    };
+    for (int i = 0; i < batch_size; ++i) {
+        queue.push([payload]() { (void)payload; });
+    }
+    drain();
+
+    size_t steady_allocations = 0;
+    for (int batch = 0; batch < batches; ++batch) {
+        {
+            AllocationCounter counter;
+            for (int i = 0; i < batch_size; ++i) {
+                queue.push([payload]() { (void)payload; });
+            }
+            steady_allocations += counter.count();
+        }
+        drain();
+    }
+    // blocks freed by exited consumer threads come back through the shared pool
+    EXPECT_EQ(steady_allocations, 0u);
+}
+
+TEST(TaskTest, priorityQueueScheduleDoesNotAllocate) {
+    PriorityQueue pq({{TaskPriority::High, {true, 1000, QueueType::LockFree}}, {TaskPriority::Normal, {false, {}}}});
+    int executed = 0;
+
+    AllocationCounter counter;
+    for (int i = 0; i < 1000; ++i) {
+        pq.push(TaskPriority::High, [&executed, i]() { executed += i; });
+    }
+    for (int i = 0; i < 1000; ++i) {
+        auto task = pq.pop();
+        ASSERT_TRUE(task.has_value());
+        (*task)();
+    }
+    EXPECT_EQ(counter.count(), 0u);
+    EXPECT_EQ(executed, 999 * 1000 / 2);
+}
+
+TEST(TaskTest, dispatcherAcceptsMoveOnlyTask) {
+    TaskDispatcher dispatcher(2);
+    std::promise<int> promise;
+    auto future = promise.get_future();
+
+    dispatcher.schedule(TaskPriority::Normal, [promise = std::move(promise)]() mutable { promise.set_value(7); });
+    EXPECT_EQ(future.get(), 7);
+}
@@ -1,4 +1,6 @@
 #include "task_dispatcher.hpp"
+#include <chrono>
+#include <filesystem>
 #include <future>
 #include <gtest/gtest.h>
 
@@ -142,4 +144,384 @@ TEST_F(TaskDispatcherTest, complexSchedule) {
     }
     all_tasks_completed.get_future().get();
     EXPECT_EQ(total_tasks_completed.load(), total_tasks);
-}
\ No newline at end of file
+}
+
+TEST_F(TaskDispatcherTest, workStealingNestedSchedule) {
+    TaskDispatcher dispatcher(4, default_config_, {.work_stealing = true});
+    const int fan_out = 8;
+    const int total_tasks = fan_out * fan_out;
+    std::atomic<int> tasks_completed{0};
+    std::promise<void> all_tasks_done;
+
+    for (int i = 0; i < fan_out; ++i) {
+        dispatcher.schedule(TaskPriority::Normal, [&dispatcher, &tasks_completed, &all_tasks_done, fan_out]() {
+            // scheduled from a worker, so these land in its own deque and get stolen by idle peers
+            for (int j = 0; j < fan_out; ++j) {
+                dispatcher.schedule(TaskPriority::Normal, [&tasks_completed, &all_tasks_done]() {
+                    if (++tasks_completed == total_tasks) {
+                        all_tasks_done.set_value();
+                    }
+                });
+            }
+        });
+    }
+
+    all_tasks_done.get_future().get();
+    EXPECT_EQ(tasks_completed.load(), total_tasks);
+}
+
+TEST_F(TaskDispatcherTest, workStealingHighBeforeNormal) {
+    TaskDispatcher dispatcher(1, default_config_, {.work_stealing = true});
+    std::vector<int> execution_order;
+    std::promise<void> all_tasks_done;
+
+    dispatcher.schedule(TaskPriority::Normal, [&dispatcher, &execution_order, &all_tasks_done]() {
+        for (int i = 0; i < 3; ++i) {
+            dispatcher.schedule(TaskPriority::Normal, [&execution_order, &all_tasks_done]() {
+                execution_order.push_back(2);
+                if (execution_order.size() == 4) {
+                    all_tasks_done.set_value();
+                }
+            });
+        }
+        dispatcher.schedule(TaskPriority::High, [&execution_order]() { execution_order.push_back(1); });
+    });
+
+    all_tasks_done.get_future().get();
+    ASSERT_EQ(execution_order.size(), 4u);
+    EXPECT_EQ(execution_order[0], 1);
+}
+
+TEST_F(TaskDispatcherTest, manyLevels) {
+    std::unordered_map<TaskPriority, QueueOptions> config = {{TaskPriority::Critical, {true, 10}},
+                                                             {TaskPriority::Interactive, {false, {}}},
+                                                             {TaskPriority::Normal, {false, {}}},
+                                                             {TaskPriority::Scavenger, {false, {}}}};
+
+    for (bool work_stealing : {false, true}) {
+        TaskDispatcher dispatcher(1, config, {.work_stealing = work_stealing});
+        std::vector<int> execution_order;
+        std::promise<void> all_tasks_done;
+
+        // queued from inside a task so that the single worker sees all of them at once
+        dispatcher.schedule(TaskPriority::Normal, [&dispatcher, &execution_order, &all_tasks_done]() {
+            auto record = [&execution_order, &all_tasks_done](int value) {
+                execution_order.push_back(value);
+                if (execution_order.size() == 4) {
+                    all_tasks_done.set_value();
+                }
+            };
+            dispatcher.schedule(TaskPriority::Scavenger, [record]() { record(4); });
+            dispatcher.schedule(TaskPriority::Normal, [record]() { record(3); });
+            dispatcher.schedule(TaskPriority::Interactive, [record]() { record(2); });
+            dispatcher.schedule(TaskPriority::Critical, [record]() { record(1); });
+        });
+
+        all_tasks_done.get_future().get();
+        EXPECT_EQ(execution_order, (std::vector<int>{1, 2, 3, 4}));
+        EXPECT_THROW(dispatcher.schedule(TaskPriority::High, []() {}), std::invalid_argument);
+    }
+}
+
+TEST_F(TaskDispatcherTest, workStealingIdleWorkerSteals) {
+    TaskDispatcher dispatcher(2, default_config_, {.work_stealing = true});
+    std::promise<void> child_done;
+    std::promise<bool> stolen;
+
+    dispatcher.schedule(TaskPriority::Normal, [&dispatcher, &child_done, &stolen]() {
+        dispatcher.schedule(TaskPriority::Normal, [&child_done]() { child_done.set_value(); });
+        // the child sits in this worker's deque, only a peer can run it while we wait here
+        auto status = child_done.get_future().wait_for(std::chrono::seconds(5));
+        stolen.set_value(status == std::future_status::ready);
+    });
+
+    EXPECT_TRUE(stolen.get_future().get());
+}
+
+TEST_F(TaskDispatcherTest, idleStrategies) {
+    for (bool work_stealing : {false, true}) {
+        for (auto idle : {IdleStrategy::park(), IdleStrategy::balanced(), IdleStrategy::low_latency()}) {
+            TaskDispatcher dispatcher(2, default_config_, {.work_stealing = work_stealing}, {.idle = idle});
+            std::atomic<int> executed{0};
+            std::promise<void> all_done;
+            for (int i = 0; i < 200; ++i) {
+                dispatcher.schedule(i % 2 ? TaskPriority::High : TaskPriority::Normal, [&executed, &all_done]() {
+                    if (++executed == 200) {
+                        all_done.set_value();
+                    }
+                });
+                if (i % 50 == 0) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            }
+            EXPECT_EQ(all_done.get_future().wait_for(std::chrono::seconds(5)), std::future_status::ready);
+        }
+    }
+}
+
+TEST_F(TaskDispatcherTest, scheduleRange) {
+    TaskDispatcher dispatcher(4);
+    const int num_tasks = 500;
+    std::atomic<int> tasks_completed{0};
+    std::promise<void> all_tasks_done;
+
+    auto make_task = [&tasks_completed, &all_tasks_done](int) {
+        return [&tasks_completed, &all_tasks_done]() {
+            if (++tasks_completed == num_tasks) {
+                all_tasks_done.set_value();
+            }
+        };
+    };
+    dispatcher.schedule_range(TaskPriority::Normal, std::views::iota(0, num_tasks) | std::views::transform(make_task));
+
+    all_tasks_done.get_future().get();
+    EXPECT_EQ(tasks_completed.load(), num_tasks);
+}
+
+TEST_F(TaskDispatcherTest, tryScheduleBulkPartial) {
+    std::unordered_map<TaskPriority, QueueOptions> config = {{TaskPriority::High, {true, 2}},
+                                                             {TaskPriority::Normal, {false, {}}}};
+    TaskDispatcher dispatcher(1, config);
+    std::promise<void> release;
+    std::promise<void> worker_busy;
+    auto released = release.get_future().share();
+
+    // keep the only worker busy so the High lane cannot drain
+    dispatcher.schedule(TaskPriority::Normal, [&worker_busy, released]() {
+        worker_busy.set_value();
+        released.wait();
+    });
+    worker_busy.get_future().get();
+
+    std::atomic<int> executed{0};
+    std::vector<Task> tasks;
+    for (int i = 0; i < 5; ++i) {
+        tasks.emplace_back([&executed]() { executed++; });
+    }
+    EXPECT_EQ(dispatcher.try_schedule_bulk(TaskPriority::High, tasks), 2u);
+
+    std::vector<Task> with_null;
+    with_null.emplace_back([]() {});
+    with_null.emplace_back(nullptr);
+    EXPECT_THROW(dispatcher.schedule_bulk(TaskPriority::Normal, with_null), std::invalid_argument);
+
+    release.set_value();
+    while (executed.load() < 2) {
+        std::this_thread::yield();
+    }
+    EXPECT_EQ(executed.load(), 2);
+}
+
+TEST_F(TaskDispatcherTest, tryScheduleAndScheduleFor) {
+    using namespace std::chrono_literals;
+    std::unordered_map<TaskPriority, QueueOptions> config = {{TaskPriority::High, {true, 1}},
+                                                             {TaskPriority::Normal, {false, {}}}};
+    TaskDispatcher dispatcher(1, config);
+    std::promise<void> release;
+    std::promise<void> worker_busy;
+    auto released = release.get_future().share();
+
+    dispatcher.schedule(TaskPriority::Normal, [&worker_busy, released]() {
+        worker_busy.set_value();
+        released.wait();
+    });
+    worker_busy.get_future().get();
+
+    std::atomic<int> executed{0};
+    EXPECT_TRUE(dispatcher.try_schedule(TaskPriority::High, [&executed]() { executed++; }));
+    EXPECT_FALSE(dispatcher.try_schedule(TaskPriority::High, [&executed]() { executed++; }));
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_FALSE(dispatcher.schedule_for(TaskPriority::High, 20ms, [&executed]() { executed++; }));
+    EXPECT_GE(std::chrono::steady_clock::now() - start, 20ms);
+    EXPECT_THROW(dispatcher.try_schedule(TaskPriority::High, nullptr), std::invalid_argument);
+    EXPECT_THROW(dispatcher.try_schedule(TaskPriority::Low, []() {}), std::invalid_argument);
+
+    release.set_value();
+    EXPECT_TRUE(dispatcher.schedule_for(TaskPriority::High, 5s, [&executed]() { executed++; }));
+    while (executed.load() < 2) {
+        std::this_thread::yield();
+    }
+    EXPECT_EQ(executed.load(), 2);
+    if (metrics::kEnabled) {
+        auto high = dispatcher.metrics().lanes[0];
+        EXPECT_EQ(high.rejected, 2u);
+        EXPECT_EQ(high.enqueued, 2u);
+    }
+}
+
+TEST_F(TaskDispatcherTest, normalLatencyBoundedUnderHighLoad) {
+    using namespace std::chrono_literals;
+    using Clock = std::chrono::steady_clock;
+    default_config_[TaskPriority::High].weight = 8;
+
+    for (auto scheduling : {SchedulingOptions{.policy = SchedulingPolicy::WeightedRoundRobin},
+                            SchedulingOptions{.aging_threshold = 5ms}}) {
+        TaskDispatcher dispatcher(2, default_config_, {}, scheduling);
+        std::atomic<bool> stop{false};
+
+        // keeps the High lane full: under strict priority no Normal task would ever run
+        std::vector<std::jthread> producers;
+        for (int i = 0; i < 2; ++i) {
+            producers.emplace_back([&dispatcher, &stop]() {
+                while (!stop.load()) {
+                    dispatcher.schedule(TaskPriority::High, []() {
+                        auto until = Clock::now() + 50us;
+                        while (Clock::now() < until) {
+                        }
+                    });
+                }
+            });
+        }
+
+        Clock::duration worst{};
+        for (int i = 0; i < 20; ++i) {
+            std::promise<Clock::duration> latency;
+            auto scheduled = Clock::now();
+            dispatcher.schedule(TaskPriority::Normal,
+                                [&latency, scheduled]() { latency.set_value(Clock::now() - scheduled); });
+            auto result = latency.get_future();
+            ASSERT_EQ(result.wait_for(10s), std::future_status::ready);
+            worst = std::max(worst, result.get());
+        }
+
+        stop = true;
+        producers.clear();
+        EXPECT_LT(worst, 1s);
+    }
+}
+
+TEST_F(TaskDispatcherTest, scheduleAfter) {
+    using namespace std::chrono_literals;
+    TaskDispatcher dispatcher(2, default_config_);
+    std::promise<std::chrono::steady_clock::time_point> ran_at;
+    std::atomic<bool> cancelled_ran{false};
+
+    auto scheduled = std::chrono::steady_clock::now();
+    dispatcher.schedule_after(TaskPriority::High, 20ms,
+                              [&ran_at]() { ran_at.set_value(std::chrono::steady_clock::now()); });
+    auto handle = dispatcher.schedule_after(TaskPriority::Normal, 10ms, [&cancelled_ran]() { cancelled_ran = true; });
+    EXPECT_TRUE(handle.cancel());
+
+    auto result = ran_at.get_future();
+    ASSERT_EQ(result.wait_for(5s), std::future_status::ready);
+    EXPECT_GE(result.get() - scheduled, 20ms);
+    EXPECT_FALSE(cancelled_ran.load());
+
+    EXPECT_THROW(dispatcher.schedule_after(TaskPriority::High, 1ms, nullptr), std::invalid_argument);
+    EXPECT_THROW(dispatcher.schedule_after(TaskPriority::Critical, 1ms, []() {}), std::invalid_argument);
+    EXPECT_THROW(dispatcher.schedule_every(TaskPriority::High, 0ms, []() {}), std::invalid_argument);
+}
+
+TEST_F(TaskDispatcherTest, scheduleEvery) {
+    using namespace std::chrono_literals;
+    TaskDispatcher dispatcher(2, default_config_);
+    std::atomic<int> runs{0};
+    std::promise<void> three_runs;
+
+    auto handle = dispatcher.schedule_every(TaskPriority::Normal, 5ms, [&runs, &three_runs]() {
+        if (++runs == 3) {
+            three_runs.set_value();
+        }
+    });
+    ASSERT_EQ(three_runs.get_future().wait_for(5s), std::future_status::ready);
+    EXPECT_TRUE(handle.cancel());
+
+    // a run already handed to the queue may still finish, nothing is fired after that
+    std::this_thread::sleep_for(20ms);
+    int after_cancel = runs.load();
+    std::this_thread::sleep_for(30ms);
+    EXPECT_EQ(runs.load(), after_cancel);
+    EXPECT_FALSE(handle.cancel());
+}
+
+TEST_F(TaskDispatcherTest, scheduleSerialized) {
+    using namespace std::chrono_literals;
+    auto config = default_config_;
+    config[TaskPriority::Normal].spill = SpillOptions{std::filesystem::temp_directory_path(), 8};
+    TaskDispatcher dispatcher(2, config);
+    const int num_tasks = 200;
+    std::atomic<int> sum{0};
+    std::atomic<int> runs{0};
+    std::promise<void> all_done;
+    dispatcher.register_task_type(1, [&](std::span<const std::byte> payload) {
+        sum += static_cast<int>(payload[0]);
+        if (++runs == num_tasks) {
+            all_done.set_value();
+        }
+    });
+
+    for (int i = 0; i < num_tasks; ++i) {
+        dispatcher.schedule_serialized(TaskPriority::Normal, 1, {std::byte(i % 100)});
+    }
+    ASSERT_EQ(all_done.get_future().wait_for(5s), std::future_status::ready);
+    EXPECT_EQ(sum.load(), 2 * 4950);
+    EXPECT_THROW(dispatcher.schedule_serialized(TaskPriority::Normal, 2, {}), std::invalid_argument);
+}
+
+TEST_F(TaskDispatcherTest, scheduleWithDeadline) {
+    using namespace std::chrono_literals;
+    auto config = default_config_;
+    config[TaskPriority::Normal].type = QueueType::Deadline;
+    TaskDispatcher dispatcher(1, config);
+    EXPECT_THROW(dispatcher.schedule(TaskPriority::High, []() {}, std::chrono::steady_clock::now() + 1s),
+                 std::invalid_argument);
+    EXPECT_THROW(dispatcher.schedule(TaskPriority::Normal, nullptr, std::chrono::steady_clock::now() + 1s),
+                 std::invalid_argument);
+
+    // the only worker is held while the lane fills up
+    std::promise<void> release;
+    std::promise<void> blocked;
+    dispatcher.schedule(TaskPriority::High, [&release, &blocked]() {
+        blocked.set_value();
+        release.get_future().wait();
+    });
+    blocked.get_future().wait();
+
+    std::vector<int> seen;
+    std::promise<void> done;
+    auto now = std::chrono::steady_clock::now();
+    dispatcher.schedule(TaskPriority::Normal, [&seen]() { seen.push_back(3); }, now + 30s);
+    dispatcher.schedule(TaskPriority::Normal, [&seen]() { seen.push_back(-1); }, now + 20ms);
+    dispatcher.schedule(TaskPriority::Normal, [&seen]() { seen.push_back(1); }, now + 10s);
+    dispatcher.schedule(TaskPriority::Normal, [&seen]() { seen.push_back(2); }, now + 20s);
+    dispatcher.schedule(TaskPriority::Normal, [&done]() { done.set_value(); });
+    std::this_thread::sleep_for(50ms);
+    release.set_value();
+
+    ASSERT_EQ(done.get_future().wait_for(5s), std::future_status::ready);
+    EXPECT_EQ(seen, (std::vector<int>{1, 2, 3}));
+    if (metrics::kEnabled) {
+        EXPECT_EQ(dispatcher.metrics().lanes[1].expired, 1u);
+    }
+}
+
+TEST_F(TaskDispatcherTest, rateLimitedLane) {
+    using namespace std::chrono_literals;
+    auto config = default_config_;
+    config[TaskPriority::Normal].rate_limit = RateLimit{200};
+    for (bool work_stealing : {false, true}) {
+        TaskDispatcher dispatcher(2, config, {.work_stealing = work_stealing});
+        const int num_tasks = 30;
+        std::atomic<int> runs{0};
+        std::promise<void> all_done;
+        auto task = [&runs, &all_done]() {
+            if (++runs == num_tasks) {
+                all_done.set_value();
+            }
+        };
+
+        auto start = std::chrono::steady_clock::now();
+        // half of them scheduled from a worker, which must not get around the limit through its own deque
+        dispatcher.schedule(TaskPriority::High, [&dispatcher, &task]() {
+            for (int i = 0; i < num_tasks / 2; ++i) {
+                dispatcher.schedule(TaskPriority::Normal, task);
+            }
+        });
+        for (int i = 0; i < num_tasks / 2; ++i) {
+            dispatcher.schedule(TaskPriority::Normal, task);
+        }
+        ASSERT_EQ(all_done.get_future().wait_for(5s), std::future_status::ready);
+        // one token every 5ms
+        EXPECT_GE(std::chrono::steady_clock::now() - start, 140ms);
+    }
+}
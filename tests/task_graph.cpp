@@ -0,0 +1,101 @@
+#include "allocation_counter.hpp"
+#include "task_graph.hpp"
+#include <atomic>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+
+using namespace dispatcher;
+using namespace dispatcher::queue;
+
+TEST(TaskGraphTest, dependenciesAreRespected) {
+    TaskDispatcher dispatcher(4);
+    TaskGraph graph;
+    // a diamond per layer: every node of a layer waits for both nodes of the previous one
+    constexpr size_t kLayers = 50;
+    std::vector<std::atomic<int>> finished(kLayers * 2);
+    std::atomic<int> violations{0};
+    std::vector<TaskGraph::Node> previous;
+    for (size_t layer = 0; layer < kLayers; ++layer) {
+        std::vector<TaskGraph::Node> current;
+        for (size_t i = 0; i < 2; ++i) {
+            size_t index = layer * 2 + i;
+            auto priority = i == 0 ? TaskPriority::High : TaskPriority::Normal;
+            current.push_back(graph.add(priority, [&finished, &violations, layer, index]() {
+                if (layer > 0 && (finished[(layer - 1) * 2].load() != finished[index].load() + 1 ||
+                                  finished[(layer - 1) * 2 + 1].load() != finished[index].load() + 1)) {
+                    violations++;
+                }
+                finished[index]++;
+            }));
+        }
+        for (auto before : previous) {
+            for (auto after : current) {
+                graph.precede(before, after);
+            }
+        }
+        previous = current;
+    }
+    EXPECT_EQ(graph.size(), kLayers * 2);
+
+    for (int run = 1; run <= 20; ++run) {
+        graph.run(dispatcher);
+        for (auto &count : finished) {
+            ASSERT_EQ(count.load(), run);
+        }
+    }
+    EXPECT_EQ(violations.load(), 0);
+}
+
+TEST(TaskGraphTest, rerunDoesNotAllocate) {
+    TaskDispatcher dispatcher(2, {{TaskPriority::High, {true, 1000, QueueType::LockFree}}});
+    TaskGraph graph;
+    std::atomic<int> executed{0};
+    auto root = graph.add(TaskPriority::High, [&executed]() { executed++; });
+    for (int i = 0; i < 100; ++i) {
+        graph.precede(root, graph.add(TaskPriority::High, [&executed]() { executed++; }));
+    }
+    graph.run(dispatcher);
+
+    test::AllocationCounter counter;
+    for (int i = 0; i < 10; ++i) {
+        graph.run(dispatcher);
+    }
+    EXPECT_EQ(counter.count(), 0u);
+    EXPECT_EQ(executed.load(), 101 * 11);
+}
+
+TEST(TaskGraphTest, exceptionSkipsDependents) {
+    TaskDispatcher dispatcher(2);
+    TaskGraph graph;
+    std::atomic<int> executed{0};
+    auto failing = graph.add(TaskPriority::Normal, []() { throw std::runtime_error("boom"); });
+    auto dependent = graph.add(TaskPriority::Normal, [&executed]() { executed++; });
+    graph.precede(failing, dependent);
+
+    EXPECT_THROW(graph.run(dispatcher), std::runtime_error);
+    EXPECT_EQ(executed.load(), 0);
+}
+
+TEST(TaskGraphTest, invalidGraphs) {
+    TaskDispatcher dispatcher(1);
+    TaskGraph empty;
+    EXPECT_NO_THROW(empty.run(dispatcher));
+
+    TaskGraph graph;
+    auto a = graph.add(TaskPriority::Normal, []() {});
+    auto b = graph.add(TaskPriority::Normal, []() {});
+    auto c = graph.add(TaskPriority::Normal, []() {});
+    EXPECT_THROW(graph.add(TaskPriority::Normal, nullptr), std::invalid_argument);
+    EXPECT_THROW(graph.precede(a, a), std::invalid_argument);
+    EXPECT_THROW(graph.precede(a, 3), std::invalid_argument);
+
+    graph.precede(a, b);
+    graph.precede(b, c);
+    graph.precede(c, b);
+    EXPECT_THROW(graph.run(dispatcher), std::invalid_argument);
+
+    TaskGraph unknown;
+    unknown.add(TaskPriority::Low, []() {});
+    EXPECT_THROW(unknown.run(dispatcher), std::invalid_argument);
+}
@@ -0,0 +1,153 @@
+#include "task_group.hpp"
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <thread>
+
+using namespace dispatcher;
+using namespace std::chrono_literals;
+
+namespace {
+
+const std::unordered_map<TaskPriority, queue::QueueOptions> kConfig = {{TaskPriority::High, {true, 1000}},
+                                                                       {TaskPriority::Normal, {false, {}}}};
+
+}  // namespace
+
+TEST(TaskGroupTest, waitRunsAll) {
+    TaskDispatcher dispatcher(4, kConfig);
+    TaskGroup group(dispatcher);
+    std::atomic<int> executed{0};
+    for (int i = 0; i < 1000; ++i) {
+        group.schedule(i % 2 ? TaskPriority::High : TaskPriority::Normal, [&executed]() { executed++; });
+    }
+    EXPECT_EQ(group.wait(), TaskGroupStatus::Complete);
+    EXPECT_EQ(executed.load(), 1000);
+
+    // reusable after wait
+    group.schedule(TaskPriority::Normal, [&executed]() { executed++; });
+    EXPECT_EQ(group.wait(), TaskGroupStatus::Complete);
+    EXPECT_EQ(executed.load(), 1001);
+}
+
+TEST(TaskGroupTest, waitHelps) {
+    TaskDispatcher dispatcher(1, kConfig);
+    std::promise<void> release;
+    std::promise<void> worker_busy;
+    auto released = release.get_future().share();
+    dispatcher.schedule(TaskPriority::Normal, [&worker_busy, released]() {
+        worker_busy.set_value();
+        released.wait();
+    });
+    worker_busy.get_future().get();
+
+    // the only worker is blocked, so the tasks can only finish if wait() runs them itself
+    TaskGroup group(dispatcher);
+    auto waiter = std::this_thread::get_id();
+    std::atomic<int> on_waiter{0};
+    for (int i = 0; i < 10; ++i) {
+        group.schedule(TaskPriority::Normal,
+                       [&on_waiter, waiter]() { on_waiter += std::this_thread::get_id() == waiter; });
+    }
+    EXPECT_EQ(group.wait(), TaskGroupStatus::Complete);
+    EXPECT_EQ(on_waiter.load(), 10);
+    release.set_value();
+}
+
+TEST(TaskGroupTest, nestedWaitInsideWorker) {
+    TaskDispatcher dispatcher(1, kConfig);
+    TaskGroup outer(dispatcher);
+    std::atomic<int> executed{0};
+
+    // the single worker waits on an inner group, which only completes because wait() helps
+    outer.schedule(TaskPriority::Normal, [&]() {
+        TaskGroup inner(dispatcher);
+        for (int i = 0; i < 5; ++i) {
+            inner.schedule(TaskPriority::Normal, [&executed]() { executed++; });
+        }
+        inner.wait();
+    });
+    EXPECT_EQ(outer.wait(), TaskGroupStatus::Complete);
+    EXPECT_EQ(executed.load(), 5);
+}
+
+TEST(TaskGroupTest, cancelDiscardsQueued) {
+    TaskDispatcher dispatcher(1, kConfig);
+    TaskGroup group(dispatcher);
+    std::promise<void> release;
+    std::promise<void> started;
+    auto released = release.get_future().share();
+    group.schedule(TaskPriority::Normal, [&started, released]() {
+        started.set_value();
+        released.wait();
+    });
+    started.get_future().get();
+
+    std::atomic<int> executed{0};
+    auto capture = std::make_shared<int>(0);
+    for (int i = 0; i < 100; ++i) {
+        group.schedule(TaskPriority::Normal, [&executed, capture]() { executed++; });
+    }
+    group.cancel();
+    EXPECT_TRUE(group.is_cancelled());
+    // the queued bodies are gone right away, not when their turn comes
+    EXPECT_EQ(capture.use_count(), 1);
+    group.schedule(TaskPriority::Normal, [&executed]() { executed++; });
+
+    release.set_value();
+    EXPECT_EQ(group.wait(), TaskGroupStatus::Cancelled);
+    EXPECT_EQ(executed.load(), 0);
+    EXPECT_FALSE(group.is_cancelled());
+}
+
+TEST(TaskGroupTest, waitRethrows) {
+    TaskDispatcher dispatcher(2, kConfig);
+    TaskGroup group(dispatcher);
+    std::atomic<int> executed{0};
+    group.schedule(TaskPriority::Normal, []() { throw std::runtime_error("boom"); });
+    for (int i = 0; i < 10; ++i) {
+        group.schedule(TaskPriority::Normal, [&executed]() { executed++; });
+    }
+    EXPECT_THROW(group.wait(), std::runtime_error);
+    EXPECT_EQ(executed.load(), 10);
+    EXPECT_EQ(group.wait(), TaskGroupStatus::Complete);
+
+    EXPECT_THROW(group.schedule(TaskPriority::Normal, nullptr), std::invalid_argument);
+    EXPECT_THROW(group.schedule(TaskPriority::Low, []() {}), std::invalid_argument);
+}
+
+TEST(TaskGroupTest, boundedLaneSlots) {
+    queue::QueueOptions rejecting{true, 4, queue::QueueType::Mutex, 1, queue::OverflowPolicy::Reject};
+    TaskDispatcher dispatcher(1, {{TaskPriority::High, rejecting}, {TaskPriority::Normal, {false, {}}}});
+    std::promise<void> release;
+    std::promise<void> worker_busy;
+    auto released = release.get_future().share();
+    dispatcher.schedule(TaskPriority::Normal, [&worker_busy, released]() {
+        worker_busy.set_value();
+        released.wait();
+    });
+    worker_busy.get_future().get();
+
+    // a hundred group tasks take one slot of the lane, one runner for the single worker
+    TaskGroup group(dispatcher);
+    std::atomic<int> group_runs{0};
+    for (int i = 0; i < 100; ++i) {
+        group.schedule(TaskPriority::High, [&group_runs]() { group_runs++; });
+    }
+    std::atomic<int> other_runs{0};
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_TRUE(dispatcher.try_schedule(TaskPriority::High, [&other_runs]() { other_runs++; }));
+    }
+    EXPECT_FALSE(dispatcher.try_schedule(TaskPriority::High, []() {}));
+
+    // the bodies are gone at once, the runner leaves the lane as a no-op
+    group.cancel();
+    release.set_value();
+    EXPECT_EQ(group.wait(), TaskGroupStatus::Cancelled);
+    while (other_runs.load() < 3) {
+        std::this_thread::yield();
+    }
+    EXPECT_EQ(group_runs.load(), 0);
+}
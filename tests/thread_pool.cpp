@@ -0,0 +1,101 @@
+#include "thread_pool/thread_pool.hpp"
+#include <atomic>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <latch>
+#include <memory>
+#include <thread>
+
+using namespace dispatcher;
+using namespace dispatcher::thread_pool;
+using namespace std::chrono_literals;
+
+namespace {
+
+std::shared_ptr<queue::PriorityQueue> make_queue() {
+    return std::make_shared<queue::PriorityQueue>(
+        std::unordered_map<TaskPriority, queue::QueueOptions>{{TaskPriority::Normal, {false, {}}}});
+}
+
+template <class Predicate>
+bool eventually(Predicate predicate, std::chrono::milliseconds timeout = 5s) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!predicate()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(1ms);
+    }
+    return true;
+}
+
+}  // namespace
+
+TEST(ThreadPoolTest, elasticGrowsAndShrinks) {
+    for (bool work_stealing : {false, true}) {
+        ThreadPool pool(make_queue(), 1,
+                        {.work_stealing = work_stealing,
+                         .max_threads = 4,
+                         .grow_after = 2ms,
+                         .idle_timeout = 50ms,
+                         .oversubscribe = true});
+        EXPECT_EQ(pool.worker_count(), 1u);
+
+        // every task blocks until all four run at once, which only a grown pool can do
+        std::latch all_running(4);
+        std::atomic<int> done{0};
+        for (int i = 0; i < 4; ++i) {
+            pool.submit(TaskPriority::Normal, [&]() {
+                all_running.arrive_and_wait();
+                done++;
+            });
+        }
+        EXPECT_TRUE(eventually([&]() { return done.load() == 4; }));
+        EXPECT_EQ(pool.worker_count(), 4u);
+
+        // the extra workers retire after idle_timeout, the minimum stays
+        EXPECT_TRUE(eventually([&]() { return pool.worker_count() == 1; }));
+
+        // and come back for the next burst
+        std::latch again(2);
+        for (int i = 0; i < 2; ++i) {
+            pool.submit(TaskPriority::Normal, [&]() {
+                again.arrive_and_wait();
+                done++;
+            });
+        }
+        EXPECT_TRUE(eventually([&]() { return done.load() == 6; }));
+    }
+}
+
+TEST(ThreadPoolTest, elasticGrowsOnDeepQueue) {
+    ThreadPool pool(make_queue(), 1, {.max_threads = 2, .grow_depth = 4, .grow_after = 1h, .oversubscribe = true});
+
+    std::atomic<bool> release{false};
+    std::atomic<bool> started{false};
+    std::atomic<int> done{0};
+    pool.submit(TaskPriority::Normal, [&]() {
+        started.store(true);
+        release.wait(false);
+    });
+    ASSERT_TRUE(eventually([&]() { return started.load(); }));
+    // grow_after is an hour, so only the depth threshold can start the second worker
+    for (int i = 0; i < 8; ++i) {
+        pool.submit(TaskPriority::Normal, [&]() { done++; });
+    }
+    EXPECT_TRUE(eventually([&]() { return done.load() == 8; }));
+    EXPECT_EQ(pool.worker_count(), 2u);
+    release.store(true);
+    release.notify_all();
+}
+
+TEST(ThreadPoolTest, threadLimits) {
+    size_t cores = std::thread::hardware_concurrency();
+    EXPECT_THROW(ThreadPool(make_queue(), cores + 1), std::invalid_argument);
+    EXPECT_THROW(ThreadPool(make_queue(), 1, {.max_threads = cores + 1}), std::invalid_argument);
+    EXPECT_THROW(ThreadPool(make_queue(), 2, {.max_threads = 1}), std::invalid_argument);
+    EXPECT_THROW(ThreadPool(make_queue(), 1, {.max_threads = 2, .idle_timeout = 0ms}), std::invalid_argument);
+
+    ThreadPool oversubscribed(make_queue(), cores + 1, {.oversubscribe = true});
+    EXPECT_EQ(oversubscribed.worker_count(), cores + 1);
+}
@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+
+#include "timer/timer_service.hpp"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace dispatcher;
+using namespace dispatcher::timer;
+using namespace std::chrono_literals;
+
+namespace {
+
+// runs due tasks right on the timer thread
+detail::Executor inline_executor() {
+    return {nullptr, [](void *, TaskPriority, Task task) { task(); }};
+}
+
+}  // namespace
+
+TEST(TimerServiceTest, firesNotBeforeDeadline) {
+    auto service = std::make_shared<TimerService>(inline_executor());
+    std::atomic<bool> fired{false};
+    std::atomic<TimerService::Clock::time_point> fired_at{};
+
+    auto when = TimerService::Clock::now() + 30ms;
+    service->add(when, TaskPriority::Normal, [&fired, &fired_at]() {
+        fired_at = TimerService::Clock::now();
+        fired = true;
+    });
+
+    while (!fired.load()) {
+        std::this_thread::sleep_for(1ms);
+    }
+    EXPECT_GE(fired_at.load(), when);
+}
+
+TEST(TimerServiceTest, earlierTimerWakesSleepingThread) {
+    auto service = std::make_shared<TimerService>(inline_executor());
+    std::atomic<int> fired{0};
+
+    service->add(TimerService::Clock::now() + 1h, TaskPriority::Normal, [&fired]() { fired += 100; });
+    std::this_thread::sleep_for(10ms);
+    service->add(TimerService::Clock::now() + 5ms, TaskPriority::Normal, [&fired]() { ++fired; });
+
+    auto deadline = TimerService::Clock::now() + 5s;
+    while (fired.load() == 0 && TimerService::Clock::now() < deadline) {
+        std::this_thread::sleep_for(1ms);
+    }
+    EXPECT_EQ(fired.load(), 1);
+}
+
+TEST(TimerServiceTest, handleCancels) {
+    TimerHandle handle;
+    std::atomic<int> fired{0};
+    {
+        auto service = std::make_shared<TimerService>(inline_executor());
+        handle = service->add(TimerService::Clock::now() + 50ms, TaskPriority::Normal, [&fired]() { ++fired; });
+        EXPECT_TRUE(handle.cancel());
+        EXPECT_FALSE(handle.cancel());
+        std::this_thread::sleep_for(80ms);
+        EXPECT_EQ(fired.load(), 0);
+
+        handle = service->add(TimerService::Clock::now() + 1h, TaskPriority::Normal, [&fired]() { ++fired; });
+    }
+    // the service is gone together with its timers
+    EXPECT_FALSE(handle.cancel());
+    EXPECT_FALSE(TimerHandle().cancel());
+}
@@ -0,0 +1,180 @@
+#include <gtest/gtest.h>
+
+#include "timer/timing_wheel.hpp"
+#include <vector>
+
+using namespace dispatcher;
+using namespace dispatcher::timer;
+
+namespace {
+
+// advances one tick at a time and records the tick every task fired at
+std::vector<std::pair<TimingWheel::Tick, int>> run_until(TimingWheel &wheel, TimingWheel::Tick until, int &fired) {
+    std::vector<std::pair<TimingWheel::Tick, int>> fires;
+    std::vector<DueTask> due;
+    while (wheel.now() < until) {
+        wheel.advance(wheel.now() + 1, due);
+        for (auto &[priority, task] : due) {
+            int before = fired;
+            task();
+            fires.emplace_back(wheel.now(), fired - before);
+        }
+        due.clear();
+    }
+    return fires;
+}
+
+}  // namespace
+
+TEST(TimingWheelTest, firesAtDeadlineOnEveryLevel) {
+    TimingWheel wheel;
+    std::vector<TimingWheel::Tick> fired_at;
+    std::vector<DueTask> due;
+
+    const std::vector<TimingWheel::Tick> deadlines = {1, 5, 255, 256, 300, 65535, 65536, 70000, 1 << 24, 20000000};
+    for (auto deadline : deadlines) {
+        wheel.insert(deadline, TaskPriority::Normal, [&fired_at, &wheel]() { fired_at.push_back(wheel.now()); });
+    }
+    EXPECT_EQ(wheel.size(), deadlines.size());
+
+    while (wheel.size() > 0) {
+        auto next = wheel.next_event();
+        ASSERT_TRUE(next.has_value());
+        ASSERT_GT(*next, wheel.now());
+        wheel.advance(*next, due);
+        for (auto &[priority, task] : due) {
+            task();
+        }
+        due.clear();
+    }
+
+    EXPECT_EQ(fired_at, deadlines);
+    EXPECT_FALSE(wheel.next_event().has_value());
+}
+
+TEST(TimingWheelTest, farDeadlineBeyondWheelReach) {
+    TimingWheel wheel;
+    const TimingWheel::Tick deadline = (TimingWheel::Tick{1} << 32) + 1000;
+    TimingWheel::Tick fired_at = 0;
+    wheel.insert(deadline, TaskPriority::Normal, [&fired_at, &wheel]() { fired_at = wheel.now(); });
+
+    std::vector<DueTask> due;
+    while (due.empty()) {
+        wheel.advance(*wheel.next_event(), due);
+    }
+    due.front().task();
+    EXPECT_EQ(fired_at, deadline);
+}
+
+TEST(TimingWheelTest, timersStraddlingLevelWrap) {
+    TimingWheel wheel;
+    std::vector<DueTask> due;
+    wheel.advance(64005, due);
+
+    // 68005 sits in level 1 past its wrap at 65536, 264005 in level 2; a few more cross the level 2 wrap
+    const std::vector<TimingWheel::Tick> deadlines = {68005, 264005, 16777000, 16790000, 17000000};
+    std::vector<TimingWheel::Tick> fired_at;
+    for (auto deadline : deadlines) {
+        wheel.insert(deadline, TaskPriority::Normal, [&fired_at, &wheel]() { fired_at.push_back(wheel.now()); });
+    }
+
+    while (wheel.size() > 0) {
+        auto next = wheel.next_event();
+        ASSERT_TRUE(next.has_value());
+        ASSERT_GT(*next, wheel.now());
+        wheel.advance(*next, due);
+        for (auto &[priority, task] : due) {
+            task();
+        }
+        due.clear();
+    }
+
+    EXPECT_EQ(fired_at, deadlines);
+}
+
+TEST(TimingWheelTest, cancel) {
+    TimingWheel wheel;
+    int fired = 0;
+    auto cancelled = wheel.insert(10, TaskPriority::Normal, [&fired]() { fired += 100; });
+    auto kept = wheel.insert(10, TaskPriority::High, [&fired]() { fired += 1; });
+    auto far = wheel.insert(100000, TaskPriority::Normal, [&fired]() { fired += 100; });
+
+    EXPECT_TRUE(wheel.cancel(cancelled));
+    EXPECT_FALSE(wheel.cancel(cancelled));
+    EXPECT_TRUE(wheel.cancel(far));
+    EXPECT_EQ(wheel.size(), 1u);
+
+    run_until(wheel, 200000, fired);
+    EXPECT_EQ(fired, 1);
+    EXPECT_FALSE(wheel.cancel(kept));
+
+    // slots of finished timers are reused under a new generation
+    std::vector<TimerId> reused;
+    for (int i = 0; i < 3; ++i) {
+        reused.push_back(wheel.insert(wheel.now() + 5, TaskPriority::Normal, []() {}));
+    }
+    EXPECT_FALSE(wheel.cancel(cancelled));
+    EXPECT_FALSE(wheel.cancel(kept));
+    for (auto id : reused) {
+        EXPECT_TRUE(wheel.cancel(id));
+    }
+}
+
+TEST(TimingWheelTest, periodic) {
+    TimingWheel wheel;
+    int fired = 0;
+    auto id = wheel.insert(10, TaskPriority::Normal, [&fired]() { ++fired; }, 10);
+
+    auto fires = run_until(wheel, 35, fired);
+    ASSERT_EQ(fires.size(), 3u);
+    EXPECT_EQ(fires[0].first, 10);
+    EXPECT_EQ(fires[1].first, 20);
+    EXPECT_EQ(fires[2].first, 30);
+
+    // a late advance fires once and keeps the original phase
+    std::vector<DueTask> due;
+    wheel.advance(35, due);
+    wheel.advance(95, due);
+    EXPECT_EQ(due.size(), 1u);
+    due.clear();
+    wheel.advance(99, due);
+    EXPECT_TRUE(due.empty());
+    wheel.advance(100, due);
+    EXPECT_EQ(due.size(), 1u);
+
+    EXPECT_TRUE(wheel.cancel(id));
+    EXPECT_EQ(wheel.size(), 0u);
+}
+
+TEST(TimingWheelTest, pastDeadlineFiresOnNextTick) {
+    TimingWheel wheel;
+    std::vector<DueTask> due;
+    wheel.advance(1000, due);
+    wheel.insert(3, TaskPriority::Normal, []() {});
+    wheel.advance(1001, due);
+    EXPECT_EQ(due.size(), 1u);
+}
+
+TEST(TimingWheelTest, millionTimers) {
+    TimingWheel wheel;
+    const int num_timers = 1000000;
+    int fired = 0;
+
+    std::vector<TimerId> ids;
+    ids.reserve(num_timers);
+    for (int i = 0; i < num_timers; ++i) {
+        ids.push_back(wheel.insert(1 + (i * 7919LL) % 100000, TaskPriority::Normal, [&fired]() { ++fired; }));
+    }
+    for (int i = 0; i < num_timers; i += 2) {
+        EXPECT_TRUE(wheel.cancel(ids[i]));
+    }
+    EXPECT_EQ(wheel.size(), static_cast<size_t>(num_timers / 2));
+
+    std::vector<DueTask> due;
+    wheel.advance(100000, due);
+    for (auto &[priority, task] : due) {
+        task();
+    }
+    EXPECT_EQ(fired, num_timers / 2);
+    EXPECT_EQ(wheel.size(), 0u);
+}
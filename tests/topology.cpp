@@ -0,0 +1,152 @@
+#include "task_dispatcher.hpp"
+#include "thread_pool/topology.hpp"
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <gtest/gtest.h>
+#include <sched.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace dispatcher;
+using namespace dispatcher::thread_pool;
+
+namespace {
+
+class FakeSysfs {
+public:
+    FakeSysfs()
+        : root_(std::filesystem::temp_directory_path() / ("dispatcher_topology_" + std::to_string(::getpid()))) {
+        std::filesystem::remove_all(root_);
+        std::filesystem::create_directories(root_);
+    }
+    ~FakeSysfs() { std::filesystem::remove_all(root_); }
+
+    void add_node(const std::string &name, const std::string &cpulist) {
+        std::filesystem::create_directories(root_ / name);
+        std::ofstream(root_ / name / "cpulist") << cpulist << '\n';
+    }
+    const std::filesystem::path &root() const { return root_; }
+
+private:
+    std::filesystem::path root_;
+};
+
+}  // namespace
+
+TEST(TopologyTest, parseCpuList) {
+    EXPECT_EQ(parse_cpu_list("0-3,8,10-11\n"), (CpuSet{0, 1, 2, 3, 8, 10, 11}));
+    EXPECT_EQ(parse_cpu_list("5"), (CpuSet{5}));
+    EXPECT_EQ(parse_cpu_list("3,1-2,2"), (CpuSet{1, 2, 3}));
+    EXPECT_TRUE(parse_cpu_list("").empty());
+    EXPECT_THROW(parse_cpu_list("1-"), std::invalid_argument);
+    EXPECT_THROW(parse_cpu_list("3-1"), std::invalid_argument);
+    EXPECT_THROW(parse_cpu_list("a"), std::invalid_argument);
+}
+
+TEST(TopologyTest, detectNodes) {
+    FakeSysfs sysfs;
+    sysfs.add_node("node10", "4-5");
+    sysfs.add_node("node2", "0-1,6");
+    sysfs.add_node("node3", "");  // memory-only node
+    sysfs.add_node("possible", "0-10");
+
+    auto topology = Topology::detect(sysfs.root());
+    ASSERT_EQ(topology.nodes.size(), 2u);
+    EXPECT_EQ(topology.nodes[0], (CpuSet{0, 1, 6}));
+    EXPECT_EQ(topology.nodes[1], (CpuSet{4, 5}));
+}
+
+TEST(TopologyTest, fallsBackToSingleNode) {
+    auto topology = Topology::detect("/nonexistent");
+    ASSERT_EQ(topology.nodes.size(), 1u);
+    EXPECT_FALSE(topology.nodes[0].empty());
+}
+
+TEST(TopologyTest, numaAwareDispatcherRunsTasks) {
+    // every worker is pinned to the CPU the test runs on, which always exists
+    auto cpu = sched_getcpu();
+    ASSERT_GE(cpu, 0);
+    for (bool work_stealing : {false, true}) {
+        TaskDispatcher dispatcher(2, {{TaskPriority::Normal, {false, {}}}},
+                                  {.work_stealing = work_stealing, .cpu_sets = {{cpu}}, .numa_aware = true});
+        std::atomic<int> on_cpu{0};
+        std::promise<void> done;
+        std::atomic<int> executed{0};
+        for (int i = 0; i < 100; ++i) {
+            dispatcher.schedule(TaskPriority::Normal, [&, cpu]() {
+                on_cpu += sched_getcpu() == cpu;
+                if (++executed == 100) {
+                    done.set_value();
+                }
+            });
+        }
+        done.get_future().get();
+        EXPECT_EQ(on_cpu.load(), 100);
+    }
+
+    EXPECT_THROW(TaskDispatcher(1, {{TaskPriority::Normal, {false, {}}}}, {.cpu_sets = {{}}}), std::invalid_argument);
+    EXPECT_THROW(TaskDispatcher(1, {{TaskPriority::Normal, {false, {}}}}, {.cpu_sets = {{-1}}}), std::invalid_argument);
+}
+
+TEST(TopologyTest, nodeLanes) {
+    using namespace std::chrono_literals;
+    // two nodes sharing the test's CPU, one worker on each
+    auto cpu = sched_getcpu();
+    ASSERT_GE(cpu, 0);
+    Topology two_nodes{{{cpu}, {cpu}}};
+    for (bool work_stealing : {false, true}) {
+        TaskDispatcher dispatcher(2, {{TaskPriority::High, {true, 100}}, {TaskPriority::Normal, {false, {}}}},
+                                  {.work_stealing = work_stealing, .numa_aware = true, .topology = two_nodes});
+
+        // tasks submitted from a worker wait on its node (or in its deque); while it blocks on them,
+        // only the worker of the other node can run them
+        std::promise<void> nested_done;
+        dispatcher.schedule(TaskPriority::Normal, [&dispatcher, &nested_done]() {
+            std::promise<void> inner_done;
+            std::atomic<int> inner{0};
+            for (int i = 0; i < 20; ++i) {
+                dispatcher.schedule(TaskPriority::Normal, [&inner, &inner_done]() {
+                    if (++inner == 20) {
+                        inner_done.set_value();
+                    }
+                });
+            }
+            inner_done.get_future().wait();
+            nested_done.set_value();
+        });
+        ASSERT_EQ(nested_done.get_future().wait_for(5s), std::future_status::ready);
+
+        // tasks waiting in node lanes count towards the lane depth
+        std::promise<void> release;
+        auto released = release.get_future().share();
+        std::atomic<int> blocked{0};
+        for (int i = 0; i < 2; ++i) {
+            dispatcher.schedule(TaskPriority::High, [&blocked, released]() {
+                blocked++;
+                released.wait();
+            });
+        }
+        while (blocked.load() < 2) {
+            std::this_thread::yield();
+        }
+        std::atomic<int> executed{0};
+        std::promise<void> done;
+        for (int i = 0; i < 10; ++i) {
+            dispatcher.schedule(TaskPriority::Normal, [&executed, &done]() {
+                if (++executed == 10) {
+                    done.set_value();
+                }
+            });
+        }
+        EXPECT_EQ(dispatcher.metrics().lanes[1].depth, 10);
+        release.set_value();
+        ASSERT_EQ(done.get_future().wait_for(5s), std::future_status::ready);
+    }
+
+    EXPECT_THROW(TaskDispatcher(1, {{TaskPriority::Normal, {false, {}}}},
+                                {.numa_aware = true, .topology = Topology{{{cpu}, {}}}}),
+                 std::invalid_argument);
+}